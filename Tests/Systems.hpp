@@ -42,6 +42,46 @@ struct DamageComponent {
     int32_t def{0};
 };
 
+struct StunnedTag {
+};
+
+struct SparseStunnedTag {
+    static constexpr bool kSparse = true;
+};
+
+struct MaterialComponent {
+    int32_t id{0};
+    float roughness{0.5F};
+    float metallic{0.0F};
+    float tint[4]{1.0F, 1.0F, 1.0F, 1.0F};
+};
+
+struct SharedMaterialComponent {
+    static constexpr bool kShared = true;
+
+    int32_t id{0};
+    float roughness{0.5F};
+    float metallic{0.0F};
+    float tint[4]{1.0F, 1.0F, 1.0F, 1.0F};
+};
+
+struct SleepStateComponent {
+    bool awake{true};
+};
+
+struct AwakeComponent {
+    static constexpr bool kEnableable = true;
+
+    float energy{1.0F};
+};
+
+struct ChunkBoundsComponent {
+    static constexpr bool kChunk = true;
+
+    float minX{0.0F};
+    float maxX{-1.0F};
+};
+
 struct DataComponent {
     inline static constexpr uint32_t DefaultSeed = 340383L;
 
@@ -57,6 +97,15 @@ struct DataComponent {
     }
 };
 
+// The components every benchmark system touches get fixed ids, so their lookups fold to constants.
+ECS_COMPONENT_ID(PositionComponent, 1);
+ECS_COMPONENT_ID(VelocityComponent, 2);
+ECS_COMPONENT_ID(SpriteComponent, 3);
+ECS_COMPONENT_ID(PlayerComponent, 4);
+ECS_COMPONENT_ID(HealthComponent, 5);
+ECS_COMPONENT_ID(DamageComponent, 6);
+ECS_COMPONENT_ID(DataComponent, 7);
+
 class DamageSystem final : public ECS::SystemComponentView<HealthComponent, DamageComponent> {
     using SystemComponentView::SystemComponentView;
 
@@ -3,12 +3,30 @@
 //
 
 #include <memory>
+#include <mutex>
+#include <numeric>
 #include <random>
+#include <thread>
 #include <benchmark/benchmark.h>
+#include "ECS/EntityCommandBuffer.hpp"
 #include "ECS/EntityManager.hpp"
+#include "ECS/ParallelCommandBuffer.hpp"
 #include "random.h"
 #include "Systems.hpp"
 
+static void reportChunkPages(benchmark::State &state, const ECS::EntityManager &entityManager) {
+    const auto stats = entityManager.getMemoryStats();
+    state.counters["hugePageMB"] = static_cast<double>(stats.hugePageBytes) / (1024 * 1024);
+    state.counters["committedMB"] = static_cast<double>(stats.committedBytes) / (1024 * 1024);
+}
+
+static void BM_createWorld(benchmark::State &state) {
+    for (auto _: state) {
+        auto entityManager = ECS::EntityManager();
+        benchmark::DoNotOptimize(entityManager.createWithComponents(PositionComponent()));
+    }
+}
+
 static void BM_createEntities(benchmark::State &state) {
     const auto entities = state.range(0);
     auto entityManager = ECS::EntityManager();
@@ -20,6 +38,533 @@ static void BM_createEntities(benchmark::State &state) {
     state.SetItemsProcessed(state.iterations() * entities);
 }
 
+static void BM_createEntitiesBatch(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    for (auto _: state) {
+        benchmark::DoNotOptimize(entityManager.createBatch<PositionComponent, VelocityComponent, SpriteComponent>(
+            entities, [](const size_t index, PositionComponent &position, VelocityComponent &, SpriteComponent &) {
+                position.x = static_cast<float>(index);
+            }));
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_createEntitiesFromSpans(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    const std::vector<PositionComponent> positions(entities);
+    const std::vector<VelocityComponent> velocities(entities);
+    const std::vector<SpriteComponent> sprites(entities);
+    for (auto _: state) {
+        benchmark::DoNotOptimize(entityManager.createBatch<PositionComponent, VelocityComponent, SpriteComponent>(positions, velocities, sprites));
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_createArchetypes(benchmark::State &state) {
+    const auto archetypesCount = state.range(0);
+    constexpr ECS::ComponentType kTypes = 16;
+    alignas(16) std::array<char, 16> scratch{};
+    ECS::Chunks::ChunkPoolStats stats;
+    for (auto _: state) {
+        const auto registry = std::make_shared<ECS::ComponentRegistry>();
+        registry->registerComponent({0, sizeof(ECS::Entity), alignof(ECS::Entity)});
+        for (ECS::ComponentType type = 1; type <= kTypes; ++type) {
+            registry->registerComponent({type, static_cast<uint16_t>(4 * (1 + type % 4)), 4});
+        }
+        const auto pool = std::make_shared<ECS::Chunks::ChunkPool>();
+        const auto factory = ECS::ArchetypeFactory(registry, pool);
+        std::vector<std::unique_ptr<ECS::Archetype> > archetypes;
+        archetypes.reserve(archetypesCount);
+        for (auto i = 1; i <= archetypesCount; i++) {
+            ECS::Signature signature;
+            signature.set(0);
+            for (ECS::ComponentType bit = 0; bit < kTypes; ++bit) {
+                if (i & (1 << bit)) {
+                    signature.set(bit + 1);
+                }
+            }
+            auto archetype = factory.createArchetypeDynamic(signature);
+            ECS::Entity entity = i;
+            std::array<void *, MAX_COMPONENTS> record{};
+            record.fill(scratch.data());
+            record[0] = &entity;
+            archetype->set(record);
+            archetypes.push_back(std::move(archetype));
+        }
+        stats = pool->getStats();
+    }
+    state.counters["reservedMB"] = static_cast<double>(stats.reservedBytes) / (1024 * 1024);
+    state.counters["committedMB"] = static_cast<double>(stats.committedBytes) / (1024 * 1024);
+    state.SetItemsProcessed(state.iterations() * archetypesCount);
+}
+
+static void BM_spawnWaves(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    std::vector<ECS::Entity> wave;
+    wave.reserve(entities);
+    auto waveIndex = 0;
+    for (auto _: state) {
+        for (auto i = 0; i < entities; i++) {
+            switch (waveIndex % 3) {
+                case 0:
+                    wave.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent()));
+                    break;
+                case 1:
+                    wave.push_back(entityManager.createWithComponents(PositionComponent(), HealthComponent()));
+                    break;
+                default:
+                    wave.push_back(entityManager.createWithComponents(PositionComponent(), DamageComponent(), SpriteComponent()));
+                    break;
+            }
+        }
+        for (const auto entity: wave) {
+            entityManager.remove(entity);
+        }
+        wave.clear();
+        ++waveIndex;
+    }
+    const auto stats = entityManager.getMemoryStats();
+    state.counters["peakChunks"] = static_cast<double>(stats.peakChunksInUse);
+    state.counters["committedMB"] = static_cast<double>(stats.committedBytes) / (1024 * 1024);
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_spawnPrefabWithComponents(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    for (auto _: state) {
+        for (auto i = 0; i < entities; i++) {
+            entityManager.createWithComponents(PositionComponent(), VelocityComponent(), HealthComponent{100, 100, StatusEffect::Alive},
+                                               DamageComponent{5, 2});
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_spawnPrefabWithInstantiate(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    const auto prefab = entityManager.createWithComponents(PositionComponent(), VelocityComponent(), HealthComponent{100, 100, StatusEffect::Alive},
+                                                           DamageComponent{5, 2});
+    for (auto _: state) {
+        benchmark::DoNotOptimize(entityManager.instantiate(prefab, entities));
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_churnEntities(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    std::vector<ECS::Entity> alive;
+    alive.reserve(entities);
+    for (auto i = 0; i < entities; i++) {
+        alive.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent()));
+    }
+    std::mt19937 gen(42);
+    std::shuffle(alive.begin(), alive.end(), gen);
+    for (auto i = 0; i < entities / 2; i++) {
+        entityManager.remove(alive.back());
+        alive.pop_back();
+    }
+    constexpr auto kOperations = 10000;
+    for (auto _: state) {
+        for (auto i = 0; i < kOperations; i++) {
+            const auto victim = std::uniform_int_distribution<size_t>(0, alive.size() - 1)(gen);
+            entityManager.remove(alive[victim]);
+            alive[victim] = entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kOperations);
+}
+
+static void BM_migrateEntities(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    std::vector<ECS::Entity> alive;
+    alive.reserve(entities);
+    for (auto i = 0; i < entities; i++) {
+        alive.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent()));
+    }
+    for (auto _: state) {
+        for (const auto entity: alive) {
+            entityManager.setComponent(entity, HealthComponent());
+        }
+        for (const auto entity: alive) {
+            entityManager.removeComponent<HealthComponent>(entity);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 2);
+}
+
+static void BM_migrateEntitiesWithTag(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    std::vector<ECS::Entity> alive;
+    alive.reserve(entities);
+    for (auto i = 0; i < entities; i++) {
+        alive.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent()));
+    }
+    for (auto _: state) {
+        for (const auto entity: alive) {
+            entityManager.setComponent(entity, StunnedTag());
+        }
+        for (const auto entity: alive) {
+            entityManager.removeComponent<StunnedTag>(entity);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 2);
+}
+
+// Same toggles as BM_migrateEntitiesWithTag, but the tag lives in a sparse set and the entities never move.
+static void BM_toggleSparseTag(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    std::vector<ECS::Entity> alive;
+    alive.reserve(entities);
+    for (auto i = 0; i < entities; i++) {
+        alive.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent()));
+    }
+    for (auto _: state) {
+        for (const auto entity: alive) {
+            entityManager.setComponent(entity, SparseStunnedTag());
+        }
+        for (const auto entity: alive) {
+            entityManager.removeComponent<SparseStunnedTag>(entity);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 2);
+}
+
+static void BM_migrateEntitiesWithComponentPair(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    std::vector<ECS::Entity> alive;
+    alive.reserve(entities);
+    for (auto i = 0; i < entities; i++) {
+        alive.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent()));
+    }
+    for (auto _: state) {
+        for (const auto entity: alive) {
+            entityManager.setComponents(entity, HealthComponent(), DamageComponent());
+        }
+        for (const auto entity: alive) {
+            entityManager.removeComponent<DamageComponent>(entity);
+            entityManager.removeComponent<HealthComponent>(entity);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 3);
+}
+
+static std::vector<ECS::Entity> spawnMixedArchetypes(ECS::EntityManager &entityManager, const size_t entities) {
+    std::vector<ECS::Entity> spawned;
+    spawned.reserve(entities);
+    for (size_t i = 0; i < entities; i++) {
+        switch (i % 4) {
+            case 0:
+                spawned.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent()));
+                break;
+            case 1:
+                spawned.push_back(entityManager.createWithComponents(PositionComponent(), SpriteComponent()));
+                break;
+            case 2:
+                spawned.push_back(entityManager.createWithComponents(PositionComponent(), HealthComponent()));
+                break;
+            default:
+                spawned.push_back(entityManager.createWithComponents(PositionComponent(), VelocityComponent(), SpriteComponent()));
+                break;
+        }
+    }
+    return spawned;
+}
+
+static void BM_addRemoveComponentPerEntity(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    const auto spawned = spawnMixedArchetypes(entityManager, entities);
+    for (auto _: state) {
+        for (const auto entity: spawned) {
+            entityManager.setComponent(entity, DamageComponent{1, 1});
+        }
+        for (const auto entity: spawned) {
+            entityManager.removeComponent<DamageComponent>(entity);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 2);
+}
+
+static void BM_addRemoveComponentToAll(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    spawnMixedArchetypes(entityManager, entities);
+    for (auto _: state) {
+        entityManager.addComponentToAll(ECS::EntityManager::Query<PositionComponent>{}, ECS::EntityManager::Query<>{}, DamageComponent{1, 1});
+        entityManager.removeComponentFromAll<DamageComponent>(ECS::EntityManager::Query<PositionComponent>{});
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 2);
+}
+
+static void BM_addRemoveComponentWithCommandBuffer(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    const auto spawned = spawnMixedArchetypes(entityManager, entities);
+    ECS::EntityCommandBuffer commands(entityManager);
+    for (auto _: state) {
+        for (const auto entity: spawned) {
+            commands.setComponent(entity, DamageComponent{1, 1});
+        }
+        commands.playback();
+        for (const auto entity: spawned) {
+            commands.removeComponent<DamageComponent>(entity);
+        }
+        commands.playback();
+    }
+    state.SetItemsProcessed(state.iterations() * entities * 2);
+}
+
+template<typename Record>
+static void recordOnThreads(const std::vector<ECS::Entity> &entities, const size_t threadCount, Record &&record) {
+    std::vector<std::thread> threads;
+    const auto share = (entities.size() + threadCount - 1) / threadCount;
+    for (size_t slot = 0; slot < threadCount; ++slot) {
+        threads.emplace_back([&, slot] {
+            const auto begin = std::min(entities.size(), slot * share);
+            const auto end = std::min(entities.size(), begin + share);
+            for (size_t i = begin; i < end; ++i) {
+                record(slot, entities[i]);
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+}
+
+static void BM_recordCommandsWithSharedBuffer(benchmark::State &state) {
+    const auto entities = state.range(0);
+    const auto threadCount = static_cast<size_t>(state.range(1));
+    auto entityManager = ECS::EntityManager();
+    const auto spawned = spawnMixedArchetypes(entityManager, entities);
+    ECS::EntityCommandBuffer commands(entityManager);
+    std::mutex mutex;
+    for (auto _: state) {
+        recordOnThreads(spawned, threadCount, [&](size_t, const ECS::Entity entity) {
+            const std::lock_guard lock(mutex);
+            commands.setComponent(entity, DamageComponent{1, 1});
+            if (entity % 16 == 0) {
+                commands.create(DamageComponent{2, 2});
+            }
+        });
+        commands.playback();
+        state.PauseTiming();
+        entityManager.removeComponentFromAll<DamageComponent>(ECS::EntityManager::Query<PositionComponent>{});
+        entityManager.destroyAll(ECS::EntityManager::Query<DamageComponent>{});
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_recordCommandsPerThread(benchmark::State &state) {
+    const auto entities = state.range(0);
+    const auto threadCount = static_cast<size_t>(state.range(1));
+    auto entityManager = ECS::EntityManager();
+    const auto spawned = spawnMixedArchetypes(entityManager, entities);
+    ECS::ParallelCommandBuffer commands(entityManager, threadCount, entities / 16 / threadCount + 1);
+    for (auto _: state) {
+        recordOnThreads(spawned, threadCount, [&](const size_t slot, const ECS::Entity entity) {
+            auto &writer = commands.writer(slot);
+            writer.setComponent(entity, DamageComponent{1, 1});
+            if (entity % 16 == 0) {
+                writer.create(DamageComponent{2, 2});
+            }
+        });
+        commands.playback();
+        state.PauseTiming();
+        entityManager.removeComponentFromAll<DamageComponent>(ECS::EntityManager::Query<PositionComponent>{});
+        entityManager.destroyAll(ECS::EntityManager::Query<DamageComponent>{});
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void spawnHalfDead(ECS::EntityManager &entityManager, const size_t entities) {
+    entityManager.createBatch<PositionComponent, HealthComponent>(entities, [](const size_t index, PositionComponent &, HealthComponent &health) {
+        health.status = index % 2 == 0 ? StatusEffect::Dead : StatusEffect::Alive;
+    });
+}
+
+static void BM_destroyDeadOneByOne(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    auto view = entityManager.createComponentView<ECS::Entity, const HealthComponent>();
+    std::vector<ECS::Entity> dead;
+    for (auto _: state) {
+        state.PauseTiming();
+        spawnHalfDead(entityManager, entities);
+        state.ResumeTiming();
+        view.forEach([&](const ECS::Entity &entity, const HealthComponent &health) {
+            if (health.status == StatusEffect::Dead) {
+                dead.push_back(entity);
+            }
+            return true;
+        });
+        for (const auto entity: dead) {
+            entityManager.remove(entity);
+        }
+        dead.clear();
+        state.PauseTiming();
+        entityManager.destroyAll(ECS::EntityManager::Query<HealthComponent>{});
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * entities / 2);
+}
+
+static void BM_destroyDeadWithPredicate(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    for (auto _: state) {
+        state.PauseTiming();
+        spawnHalfDead(entityManager, entities);
+        state.ResumeTiming();
+        entityManager.destroy(ECS::EntityManager::Query<const HealthComponent>{}, ECS::EntityManager::Query<>{}, [](const HealthComponent &health) {
+            return health.status == StatusEffect::Dead;
+        });
+        state.PauseTiming();
+        entityManager.destroyAll(ECS::EntityManager::Query<HealthComponent>{});
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * entities / 2);
+}
+
+static constexpr int32_t kMaterials = 8;
+
+static void BM_iterateMaterialPerEntity(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    for (auto i = 0; i < entities; i++) {
+        entityManager.createWithComponents(PositionComponent(), MaterialComponent{i % kMaterials, 0.1F * static_cast<float>(i % kMaterials)});
+    }
+    auto view = entityManager.createComponentView<PositionComponent, const MaterialComponent>();
+    for (auto _: state) {
+        view.forEach([&](auto &position, const auto &material) {
+            position.x += material.roughness * material.tint[0];
+            return true;
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+    state.counters["chunks"] = static_cast<double>(entityManager.getMemoryStats().chunksInUse);
+}
+
+static void BM_iterateSharedMaterialPerChunk(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    for (auto i = 0; i < entities; i++) {
+        entityManager.createWithComponents(PositionComponent(), SharedMaterialComponent{i % kMaterials, 0.1F * static_cast<float>(i % kMaterials)});
+    }
+    auto view = entityManager.createComponentView<PositionComponent, const SharedMaterialComponent>();
+    for (auto _: state) {
+        view.forEachChunk([&](const size_t count, PositionComponent *positions, const SharedMaterialComponent *material) {
+            const float shade = material->roughness * material->tint[0];
+            for (size_t i = 0; i < count; ++i) {
+                positions[i].x += shade;
+            }
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+    state.counters["chunks"] = static_cast<double>(entityManager.getMemoryStats().chunksInUse);
+}
+
+// Entities are laid out along x in creation order, and a visibility pass looks at 1% of that range.
+static constexpr float kVisibleFraction = 0.01F;
+
+static void BM_cullEntitiesPerEntity(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    entityManager.createBatch<PositionComponent>(entities, [](const size_t index, PositionComponent &position) {
+        position.x = static_cast<float>(index);
+    });
+    const float maxX = static_cast<float>(entities) * kVisibleFraction;
+    auto view = entityManager.createComponentView<const PositionComponent>();
+    size_t visible = 0;
+    for (auto _: state) {
+        view.forEach([&](const auto &position) {
+            visible += position.x <= maxX;
+            return true;
+        });
+    }
+    benchmark::DoNotOptimize(visible);
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_cullEntitiesByChunkBounds(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    entityManager.createBatch<PositionComponent>(entities, [](const size_t index, PositionComponent &position) {
+        position.x = static_cast<float>(index);
+    });
+    entityManager.addComponentToAll(ECS::EntityManager::Query<PositionComponent>{}, ECS::EntityManager::Query<>{}, ChunkBoundsComponent{});
+    auto bounds = entityManager.createComponentView<const PositionComponent, ChunkBoundsComponent>();
+    bounds.forEachChunk([](const size_t count, const PositionComponent *positions, ChunkBoundsComponent *chunkBounds) {
+        *chunkBounds = {positions[0].x, positions[0].x};
+        for (size_t i = 1; i < count; ++i) {
+            chunkBounds->minX = std::min(chunkBounds->minX, positions[i].x);
+            chunkBounds->maxX = std::max(chunkBounds->maxX, positions[i].x);
+        }
+    });
+    const float maxX = static_cast<float>(entities) * kVisibleFraction;
+    auto view = entityManager.createComponentView<const PositionComponent>();
+    size_t visible = 0;
+    for (auto _: state) {
+        view.forEach<ChunkBoundsComponent>([&](const ChunkBoundsComponent &chunkBounds) { return chunkBounds.minX <= maxX; }, [&](const auto &position) {
+            visible += position.x <= maxX;
+            return true;
+        });
+    }
+    benchmark::DoNotOptimize(visible);
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+// One entity in kAwakeEvery is awake; the rest are skipped either by a branch in the lambda or by enable bits.
+static constexpr int32_t kAwakeEvery = 8;
+
+static void BM_iterateAwakeWithBranch(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    entityManager.createBatch<PositionComponent, SleepStateComponent>(entities, [](const size_t index, PositionComponent &, SleepStateComponent &sleep) {
+        sleep.awake = index % kAwakeEvery == 0;
+    });
+    auto view = entityManager.createComponentView<PositionComponent, const SleepStateComponent>();
+    for (auto _: state) {
+        view.forEach([&](auto &position, const auto &sleep) {
+            if (!sleep.awake) {
+                return false;
+            }
+            position.x += 0.03F;
+            return true;
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
+static void BM_iterateAwakeWithEnableBits(benchmark::State &state) {
+    const auto entities = state.range(0);
+    auto entityManager = ECS::EntityManager();
+    const auto created = entityManager.createBatch<PositionComponent, AwakeComponent>(entities, [](size_t, PositionComponent &, AwakeComponent &) {});
+    for (size_t i = 0; i < created.size(); ++i) {
+        entityManager.setEnabled<AwakeComponent>(created[i], i % kAwakeEvery == 0);
+    }
+    auto view = entityManager.createComponentView<PositionComponent, const AwakeComponent>();
+    for (auto _: state) {
+        view.forEach([&](auto &position, const auto &awake) {
+            position.x += 0.03F * awake.energy;
+            return true;
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * entities);
+}
+
 static void BM_iterateEntitiesWith1ComponentWithForEach(benchmark::State &state) {
     const auto entities = state.range(0);
     auto entityManager = ECS::EntityManager();
@@ -49,6 +594,7 @@ static void BM_iterateEntitiesWith1ComponentWithForEach(benchmark::State &state)
             return true;
         });
     }
+    reportChunkPages(state, entityManager);
     state.SetItemsProcessed(state.iterations() * entities);
 }
 
@@ -90,12 +636,112 @@ static void BM_updateEntitiesWith6ComponentsWithForEach(benchmark::State &state)
             return true;
         });
     }
+    reportChunkPages(state, *entityManager);
     state.SetItemsProcessed(state.iterations() * entities);
 }
 
-static void BM_updateEntitiesWithMultipleSystems(benchmark::State &state) {
+static std::vector<ECS::Signature> makeSignatures(const size_t components) {
+    std::mt19937 gen(42);
+    std::vector<uint16_t> ids(MAX_COMPONENTS);
+    std::iota(ids.begin(), ids.end(), 0);
+    std::vector<ECS::Signature> signatures(1024);
+    for (auto &signature: signatures) {
+        std::ranges::shuffle(ids, gen);
+        for (size_t i = 0; i < components; ++i) {
+            signature.set(ids[i]);
+        }
+    }
+    return signatures;
+}
+
+// An archetype query over signatures with 8, 32 or 128 components.
+static void BM_matchSignatures(benchmark::State &state) {
+    const auto signatures = makeSignatures(state.range(0));
+    ECS::Signature including;
+    including.set(3);
+    including.set(70);
+    ECS::Signature excluding;
+    excluding.set(100);
+    for (auto _: state) {
+        size_t matched = 0;
+        for (const auto &signature: signatures) {
+            matched += signature.matches(including, excluding);
+        }
+        benchmark::DoNotOptimize(matched);
+    }
+    state.SetItemsProcessed(state.iterations() * signatures.size());
+}
+
+static void BM_visitSignatureBits(benchmark::State &state) {
+    const auto signatures = makeSignatures(state.range(0));
+    for (auto _: state) {
+        size_t sum = 0;
+        for (const auto &signature: signatures) {
+            signature.forEachSetBit([&](const ECS::ComponentType type) { sum += type; });
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * signatures.size());
+}
+
+static void BM_hashSignatures(benchmark::State &state) {
+    const auto signatures = makeSignatures(state.range(0));
+    for (auto _: state) {
+        size_t hash = 0;
+        for (const auto &signature: signatures) {
+            hash ^= std::hash<ECS::Signature>{}(signature);
+        }
+        benchmark::DoNotOptimize(hash);
+    }
+    state.SetItemsProcessed(state.iterations() * signatures.size());
+}
+
+template<size_t I>
+struct VariantTag {};
+
+template<size_t... Is>
+static void setVariantTags(ECS::EntityManager &entityManager, const ECS::Entity entity, const size_t mask, std::index_sequence<Is...>) {
+    ((mask & (size_t{1} << Is) ? entityManager.setComponent(entity, VariantTag<Is>{}) : void()), ...);
+}
+
+// Spawns 256 archetypes while `range(0)` views of different queries are alive.
+static void BM_createArchetypesWithViews(benchmark::State &state) {
+    for (auto _: state) {
+        state.PauseTiming();
+        ECS::EntityManager entityManager;
+        std::vector<ECS::ComponentViewSubscribed<PositionComponent> > views;
+        for (auto i = 0; i < state.range(0); i++) {
+            switch (i % 4) {
+                case 0: views.push_back(entityManager.createComponentView<PositionComponent>()); break;
+                case 1: views.push_back(entityManager.createComponentViewWithQuery(ECS::EntityManager::Query<PositionComponent>{},
+                                                                                  ECS::EntityManager::Query<VariantTag<0> >{})); break;
+                case 2: views.push_back(entityManager.createComponentViewWithQuery(ECS::EntityManager::Query<PositionComponent>{},
+                                                                                  ECS::EntityManager::Query<>{},
+                                                                                  ECS::EntityManager::Query<VariantTag<1> >{})); break;
+                default: views.push_back(entityManager.createComponentViewWithQuery(ECS::EntityManager::Query<PositionComponent>{},
+                                                                                   ECS::EntityManager::Query<VariantTag<2> >{},
+                                                                                   ECS::EntityManager::Query<VariantTag<3> >{})); break;
+            }
+        }
+        state.ResumeTiming();
+        for (size_t mask = 0; mask < 256; mask++) {
+            const auto entity = entityManager.createWithComponents(PositionComponent());
+            setVariantTags(entityManager, entity, mask, std::make_index_sequence<8>{});
+        }
+        size_t count = 0;
+        for (auto &view: views) {
+            view.forEach([&](PositionComponent &) { return ++count > 0; });
+        }
+        benchmark::DoNotOptimize(count);
+    }
+}
+
+static void updateEntitiesWithMultipleSystems(benchmark::State &state, const bool coldData) {
     const auto entities = state.range(0);
     auto entityManager = std::make_shared<ECS::EntityManager>();
+    if (coldData) {
+        entityManager->setCold<DataComponent>();
+    }
     for (auto i = 0; i < entities; i++) {
         const auto entity = entityManager->createWithComponents(PositionComponent(), SpriteComponent());
         std::random_device rd;
@@ -132,10 +778,50 @@ static void BM_updateEntitiesWithMultipleSystems(benchmark::State &state) {
             system->update(0.08);
         }
     }
+    reportChunkPages(state, *entityManager);
     state.SetItemsProcessed(state.iterations() * entities);
 }
 
+static void BM_updateEntitiesWithMultipleSystems(benchmark::State &state) {
+    updateEntitiesWithMultipleSystems(state, false);
+}
+
+// DataComponent moves to the companion block, so the hot columns of each archetype need fewer chunks.
+static void BM_updateEntitiesWithMultipleSystemsColdData(benchmark::State &state) {
+    updateEntitiesWithMultipleSystems(state, true);
+}
+
+BENCHMARK(BM_createWorld);
 BENCHMARK(BM_createEntities)->RangeMultiplier(4)->Range(1, 4194304)->Iterations(1);
+BENCHMARK(BM_createEntitiesBatch)->RangeMultiplier(4)->Range(1, 4194304)->Iterations(1);
+BENCHMARK(BM_createEntitiesFromSpans)->RangeMultiplier(4)->Range(1, 4194304)->Iterations(1);
+BENCHMARK(BM_createArchetypes)->RangeMultiplier(4)->Range(1024, 16384)->Iterations(1);
+BENCHMARK(BM_spawnWaves)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(30);
+BENCHMARK(BM_spawnPrefabWithComponents)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_spawnPrefabWithInstantiate)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_churnEntities)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_migrateEntities)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_migrateEntitiesWithTag)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_toggleSparseTag)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_migrateEntitiesWithComponentPair)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_addRemoveComponentPerEntity)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_addRemoveComponentToAll)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_addRemoveComponentWithCommandBuffer)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_recordCommandsWithSharedBuffer)->ArgsProduct({{262144}, {1, 2, 4, 8, 16, 32}})->Iterations(10);
+BENCHMARK(BM_recordCommandsPerThread)->ArgsProduct({{262144}, {1, 2, 4, 8, 16, 32}})->Iterations(10);
+BENCHMARK(BM_destroyDeadOneByOne)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_destroyDeadWithPredicate)->RangeMultiplier(8)->Range(4096, 262144)->Iterations(10);
+BENCHMARK(BM_iterateMaterialPerEntity)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_iterateSharedMaterialPerChunk)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_cullEntitiesPerEntity)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_cullEntitiesByChunkBounds)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_iterateAwakeWithBranch)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
+BENCHMARK(BM_iterateAwakeWithEnableBits)->RangeMultiplier(8)->Range(4096, 2097152)->Iterations(10);
 BENCHMARK(BM_iterateEntitiesWith1ComponentWithForEach)->RangeMultiplier(4)->Range(1, 2000000)->Iterations(10);
 BENCHMARK(BM_updateEntitiesWith6ComponentsWithForEach)->RangeMultiplier(4)->Range(1, 2000000)->Iterations(10);
+BENCHMARK(BM_matchSignatures)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_visitSignatureBits)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_hashSignatures)->Arg(8)->Arg(32)->Arg(128);
+BENCHMARK(BM_createArchetypesWithViews)->Arg(1)->Arg(16)->Arg(256);
 BENCHMARK(BM_updateEntitiesWithMultipleSystems)->RangeMultiplier(4)->Range(1, 2000000)->Iterations(10);
+BENCHMARK(BM_updateEntitiesWithMultipleSystemsColdData)->RangeMultiplier(4)->Range(1, 2000000)->Iterations(10);
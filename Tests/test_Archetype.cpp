@@ -83,3 +83,149 @@ TEST(ArchetypeTest, RemoveEntity) {
     EXPECT_TRUE(archetype->remove(e1));
     EXPECT_EQ(archetype->size(), 1);
 }
+
+TEST(ArchetypeTest, InsertReusesFreedSlotInFragmentedArchetype) {
+    const auto registry = std::make_shared<ComponentRegistry>();
+    const auto factory = ArchetypeFactory(registry);
+    auto signature = Signature();
+    for (const auto& type: types) {
+        registry->registerComponent(type);
+        signature.set(type.type);
+    }
+    const auto archetype = factory.createArchetypeDynamic(signature);
+    const auto capacity = archetype->getChunkFactory().getChunkCapacity();
+
+    A a{7};
+    B b{2.0};
+    Entity entity = 0;
+    std::array<void*, 3> data{&entity, &a, &b};
+    const auto total = static_cast<Entity>(capacity * 4);
+    for (entity = 0; entity < total; ++entity) {
+        ASSERT_TRUE(archetype->set(data));
+    }
+    EXPECT_EQ(archetype->chunkCount(), 4);
+    EXPECT_EQ(archetype->freeChunkCount(), 0);
+
+    const Entity removed = static_cast<Entity>(capacity + 3);
+    const auto location = archetype->getEntityLocation(removed);
+    ASSERT_TRUE(location.has_value());
+    EXPECT_TRUE(archetype->remove(removed));
+    EXPECT_EQ(archetype->freeChunkCount(), 1);
+
+    entity = total;
+    ASSERT_TRUE(archetype->set(data));
+    EXPECT_EQ(archetype->chunkCount(), 4);
+    EXPECT_EQ(archetype->freeChunkCount(), 0);
+    EXPECT_EQ(archetype->getEntityLocation(total)->chunkIndex, location->chunkIndex);
+    EXPECT_EQ(*static_cast<Entity *>(archetype->getComponent(total, 0)), total);
+}
+
+TEST(ArchetypeTest, CompactMergesSparseChunks) {
+    const auto registry = std::make_shared<ComponentRegistry>();
+    const auto factory = ArchetypeFactory(registry);
+    auto signature = Signature();
+    for (const auto& type: types) {
+        registry->registerComponent(type);
+        signature.set(type.type);
+    }
+    const auto archetype = factory.createArchetypeDynamic(signature);
+    const auto capacity = archetype->getChunkFactory().getChunkCapacity();
+
+    A a{};
+    B b{};
+    Entity entity = 0;
+    std::array<void*, 3> data{&entity, &a, &b};
+    const auto total = static_cast<Entity>(capacity * 4);
+    for (entity = 0; entity < total; ++entity) {
+        a.x = entity;
+        ASSERT_TRUE(archetype->set(data));
+    }
+    for (Entity e = 0; e < total; e += 2) {
+        ASSERT_TRUE(archetype->remove(e));
+    }
+    EXPECT_EQ(archetype->chunkCount(), 4);
+    EXPECT_NEAR(archetype->fillFactor(), 0.5, 0.01);
+
+    EXPECT_EQ(archetype->compact(0), 0);
+    EXPECT_NEAR(static_cast<double>(archetype->compact()), total / 4, 2);
+    EXPECT_EQ(archetype->chunkCount(), 2);
+    EXPECT_NEAR(archetype->fillFactor(), 1.0, 0.01);
+    EXPECT_EQ(archetype->size(), total / 2);
+
+    for (Entity e = 1; e < total; e += 2) {
+        const auto *value = static_cast<A *>(archetype->getComponent(e, 1));
+        ASSERT_NE(value, nullptr);
+        EXPECT_EQ(value->x, e);
+    }
+}
+
+TEST(ArchetypeTest, MemoryTracksLiveEntitiesNotEntityIds) {
+    const auto registry = std::make_shared<ComponentRegistry>();
+    const auto factory = ArchetypeFactory(registry);
+    for (const auto& type: types) {
+        registry->registerComponent(type);
+    }
+    registry->registerComponent({3, sizeof(int32_t), alignof(int32_t)});
+    registry->registerComponent({4, sizeof(int16_t), alignof(int16_t)});
+
+    A a{1};
+    B b{2.0};
+    int32_t c = 3;
+    int16_t d = 4;
+    std::array<void*, 5> data{nullptr, &a, &b, &c, &d};
+    std::vector<std::unique_ptr<Archetype> > archetypes;
+    for (auto mask = 1; mask < 16; ++mask) {
+        auto signature = Signature();
+        signature.set(0);
+        for (auto bit = 0; bit < 4; ++bit) {
+            if (mask & (1 << bit)) {
+                signature.set(bit + 1);
+            }
+        }
+        auto archetype = factory.createArchetypeDynamic(signature);
+        Entity entity = 9'000'000 + mask * 100'000;
+        data[0] = &entity;
+        ASSERT_TRUE(archetype->set(data));
+        EXPECT_EQ(*static_cast<Entity *>(archetype->getComponent(entity, 0)), entity);
+        EXPECT_LE(archetype->memoryBytes(), 2 * CHUNK_SIZE);
+        archetypes.push_back(std::move(archetype));
+    }
+    EXPECT_EQ(factory.getEntityLocations()->pageCount(), archetypes.size());
+    EXPECT_LE(factory.getEntityLocations()->memoryBytes(), archetypes.size() * 4096 * sizeof(EntityRecord) + 64 * 1024);
+}
+
+TEST(ArchetypeTest, SetPlacesRowsByTheirSharedValues) {
+    const auto registry = std::make_shared<ComponentRegistry>();
+    const auto factory = ArchetypeFactory(registry);
+    auto signature = Signature();
+    for (const auto& type: types) {
+        registry->registerComponent(type);
+        signature.set(type.type);
+    }
+    registry->registerComponent({3, sizeof(int32_t), alignof(int32_t), true});
+    signature.set(3);
+    const auto archetype = factory.createArchetypeDynamic(signature);
+
+    A a{1};
+    B b{2.0};
+    int32_t team = 5;
+    Entity entity = 1;
+    std::array<void*, 4> data{&entity, &a, &b, &team};
+    ASSERT_TRUE(archetype->set(data));
+    entity = 2;
+    team = 6;
+    ASSERT_TRUE(archetype->set(data));
+    entity = 3;
+    team = 5;
+    ASSERT_TRUE(archetype->set(data));
+
+    EXPECT_EQ(archetype->chunkCount(), 2);
+    EXPECT_EQ(*static_cast<int32_t *>(archetype->getComponent(1, 3)), 5);
+    EXPECT_EQ(*static_cast<int32_t *>(archetype->getComponent(2, 3)), 6);
+    EXPECT_EQ(archetype->getComponent(1, 3), archetype->getComponent(3, 3));
+
+    entity = 4;
+    data[3] = nullptr;
+    EXPECT_FALSE(archetype->set(data));
+    EXPECT_EQ(archetype->size(), 3);
+}
@@ -4,6 +4,7 @@
 
 #include <gtest/gtest.h>
 #include <ECS/Archetype/ArchetypeStore.hpp>
+#include <ECS/Archetype/ComponentView/SparseComponentView.hpp>
 #include <ECS/Entity.h>
 
 using namespace ECS;
@@ -23,6 +24,29 @@ struct Health {
     bool operator==(const Health& other) const { return value == other.value; }
 };
 
+struct Frozen {
+};
+
+struct Faction {
+    static constexpr bool kShared = true;
+    int id;
+};
+
+struct Bounds {
+    static constexpr bool kChunk = true;
+    float radius = -1.0f;
+};
+
+struct Targeted {
+    static constexpr bool kSparse = true;
+    int by;
+};
+
+struct Thinking {
+    static constexpr bool kEnableable = true;
+    int budget;
+};
+
 class ArchetypeStoreTest : public ::testing::Test {
 protected:
     ArchetypeStore store;
@@ -64,11 +88,148 @@ TEST_F(ArchetypeStoreTest, RemoveComponentMovesEntity) {
     EXPECT_TRUE(store.hasComponent<Position>(entity1));
 }
 
-TEST_F(ArchetypeStoreTest, RemoveLastComponentRemovesEntity) {
+TEST_F(ArchetypeStoreTest, MigrationCarriesSharedColumns) {
+    store.setComponents(entity1, Position{1, 2}, Velocity{3, 4});
+    store.setComponents(entity2, Position{5, 6}, Velocity{7, 8});
+
+    ASSERT_TRUE(store.setComponents(entity1, Health{9}));
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1, 2}));
+    EXPECT_EQ(*store.getComponent<Velocity>(entity1), (Velocity{3, 4}));
+    EXPECT_EQ(*store.getComponent<Health>(entity1), (Health{9}));
+
+    ASSERT_TRUE(store.removeComponent<Velocity>(entity1));
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1, 2}));
+    EXPECT_EQ(*store.getComponent<Health>(entity1), (Health{9}));
+    EXPECT_EQ(store.getComponent<Velocity>(entity1), nullptr);
+
+    ASSERT_TRUE(store.setComponents(entity1, Health{10}));
+    EXPECT_EQ(*store.getComponent<Health>(entity1), (Health{10}));
+
+    EXPECT_EQ(*store.getComponent<Position>(entity2), (Position{5, 6}));
+    EXPECT_EQ(*store.getComponent<Velocity>(entity2), (Velocity{7, 8}));
+}
+
+TEST_F(ArchetypeStoreTest, TagsTakeNoColumn) {
+    store.setComponents(entity1, Position{1.0f, 2.0f});
+    const auto capacity = store.getArchetype(entity1)->getChunkFactory().getChunkCapacity();
+    ASSERT_TRUE(store.setComponents(entity1, Frozen{}));
+
+    const auto *tagged = store.getArchetype(entity1);
+    EXPECT_TRUE(store.hasComponent<Frozen>(entity1));
+    EXPECT_NE(store.getComponent<Frozen>(entity1), nullptr);
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1.0f, 2.0f}));
+    EXPECT_EQ(tagged->getSignature().count(), 3);
+    EXPECT_EQ(tagged->getColumns().size(), 2);
+    EXPECT_EQ(tagged->getChunkFactory().getChunkCapacity(), capacity);
+
+    ASSERT_TRUE(store.removeComponent<Frozen>(entity1));
+    EXPECT_FALSE(store.hasComponent<Frozen>(entity1));
+    EXPECT_EQ(store.getComponent<Frozen>(entity1), nullptr);
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1.0f, 2.0f}));
+}
+
+TEST_F(ArchetypeStoreTest, SharedComponentIsStoredOncePerChunk) {
+    store.setComponents(entity1, Position{1.0f, 2.0f}, Faction{1});
+    store.setComponents(entity2, Position{3.0f, 4.0f}, Faction{2});
+    const auto *archetype = store.getArchetype(entity1);
+    ASSERT_EQ(archetype, store.getArchetype(entity2));
+    EXPECT_EQ(archetype->getColumns().size(), 2);
+    ASSERT_EQ(archetype->getSharedColumns().size(), 1);
+    ASSERT_EQ(archetype->chunkCount(), 2);
+    const auto type = ArchetypeStore::getTypeIndex<Faction>();
+    EXPECT_EQ(archetype->getChunk(0).components[type].stride, 0);
+    EXPECT_NE(archetype->getChunk(0).components[type].ptr, archetype->getChunk(1).components[type].ptr);
+
+    ASSERT_TRUE(store.setComponents(entity2, Faction{1}));
+    EXPECT_EQ(archetype->chunkCount(), 1);
+    EXPECT_EQ(store.getComponent<Faction>(entity1), store.getComponent<Faction>(entity2));
+    EXPECT_EQ(*store.getComponent<Position>(entity2), (Position{3.0f, 4.0f}));
+}
+
+TEST_F(ArchetypeStoreTest, ChunkComponentBelongsToChunk) {
+    store.setComponents(entity1, Position{1.0f, 2.0f}, Health{10}, Bounds{5.0f});
+    store.setComponents(entity2, Position{3.0f, 4.0f}, Health{20}, Bounds{7.0f});
+    const auto *archetype = store.getArchetype(entity1);
+    ASSERT_EQ(archetype, store.getArchetype(entity2));
+    EXPECT_EQ(archetype->getColumns().size(), 3);
+    EXPECT_TRUE(archetype->getSharedColumns().empty());
+    ASSERT_EQ(archetype->chunkCount(), 1);
+    EXPECT_EQ(archetype->getChunk(0).components[ArchetypeStore::getTypeIndex<Bounds>()].stride, 0);
+    // Both entities live in the same chunk, so the second write replaced the chunk's value.
+    EXPECT_EQ(store.getComponent<Bounds>(entity1), store.getComponent<Bounds>(entity2));
+    EXPECT_EQ(store.getComponent<Bounds>(entity1)->radius, 7.0f);
+
+    // A row moved into a new chunk finds that chunk's initial value.
+    ASSERT_TRUE(store.removeComponent<Health>(entity1));
+    EXPECT_EQ(store.getComponent<Bounds>(entity1)->radius, -1.0f);
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1.0f, 2.0f}));
+    EXPECT_EQ(store.getComponent<Bounds>(entity2)->radius, 7.0f);
+}
+
+TEST_F(ArchetypeStoreTest, SparseComponentTogglesWithoutMigration) {
+    store.setComponents(entity1, Position{1.0f, 2.0f});
+    const auto *archetype = store.getArchetype(entity1);
+    const auto signature = store.getSignature(entity1);
+
+    ASSERT_TRUE(store.setComponents(entity1, Targeted{7}));
+    EXPECT_EQ(store.getArchetype(entity1), archetype);
+    EXPECT_EQ(store.getSignature(entity1), signature);
+    EXPECT_TRUE(store.hasComponent<Targeted>(entity1));
+    EXPECT_EQ(store.getComponent<Targeted>(entity1)->by, 7);
+    EXPECT_FALSE(store.hasComponent<Targeted>(entity2));
+    EXPECT_EQ(store.getComponent<Targeted>(entity2), nullptr);
+
+    // Mixed sets split by storage; an entity with only sparse components still gets a row for its id.
+    ASSERT_TRUE(store.setComponents(entity2, Targeted{1}, Health{5}));
+    EXPECT_EQ(store.getComponent<Health>(entity2)->value, 5);
+    const Entity entity3{3};
+    ASSERT_TRUE(store.setComponents(entity3, Targeted{3}));
+    EXPECT_NE(store.getArchetype(entity3), nullptr);
+
+    EXPECT_TRUE(store.removeComponent<Targeted>(entity1));
+    EXPECT_FALSE(store.removeComponent<Targeted>(entity1));
+    EXPECT_EQ(store.getArchetype(entity1), archetype);
+    EXPECT_EQ(store.getComponent<Targeted>(entity2)->by, 1);
+
+    EXPECT_TRUE(store.removeEntity(entity2));
+    EXPECT_FALSE(store.hasComponent<Targeted>(entity2));
+    EXPECT_EQ(store.getSparseSet(ArchetypeStore::getTypeIndex<Targeted>())->count(), 1);
+}
+
+TEST_F(ArchetypeStoreTest, EnableBitsFollowTheirRows) {
+    const Entity entity3{3};
+    store.setComponents(entity1, Position{1.0f, 1.0f}, Thinking{1});
+    store.setComponents(entity2, Position{2.0f, 2.0f}, Thinking{2});
+    store.setComponents(entity3, Position{3.0f, 3.0f}, Thinking{3});
+    EXPECT_TRUE(store.isEnabled<Thinking>(entity1));
+    EXPECT_TRUE(store.isEnabled<Position>(entity1));
+
+    const auto *archetype = store.getArchetype(entity3);
+    ASSERT_TRUE(store.setEnabled<Thinking>(entity3, false));
+    EXPECT_EQ(store.getArchetype(entity3), archetype);
+    EXPECT_FALSE(store.isEnabled<Thinking>(entity3));
+    EXPECT_EQ(store.getComponent<Thinking>(entity3)->budget, 3);
+    EXPECT_FALSE(store.setEnabled<Thinking>(Entity{4}, false));
+
+    // Removing entity1 moves entity3's row into its slot, and a migration copies the row to another archetype.
+    EXPECT_TRUE(store.removeEntity(entity1));
+    EXPECT_FALSE(store.isEnabled<Thinking>(entity3));
+    EXPECT_TRUE(store.isEnabled<Thinking>(entity2));
+    ASSERT_TRUE(store.setComponents(entity3, Health{10}));
+    EXPECT_NE(store.getArchetype(entity3), archetype);
+    EXPECT_FALSE(store.isEnabled<Thinking>(entity3));
+    ASSERT_TRUE(store.setEnabled<Thinking>(entity3, true));
+    EXPECT_TRUE(store.isEnabled<Thinking>(entity3));
+}
+
+TEST_F(ArchetypeStoreTest, RemoveLastComponentKeepsEntityInEntityOnlyArchetype) {
     store.setComponents(entity1, Position{1.0f, 2.0f});
     EXPECT_TRUE(store.removeComponent<Position>(entity1));
     EXPECT_FALSE(store.hasComponent<Position>(entity1));
     EXPECT_EQ(store.getComponent<Position>(entity1), nullptr);
+    ASSERT_NE(store.getRecord(entity1).archetype, nullptr);
+    EXPECT_EQ(store.getSignature(entity1).count(), 1);
+    EXPECT_TRUE(store.hasComponent<Entity>(entity1));
 }
 
 TEST_F(ArchetypeStoreTest, RemoveEntityWorks) {
@@ -102,13 +263,256 @@ TEST_F(ArchetypeStoreTest, NotifierTriggersOnAddAndUpdate) {
     EXPECT_TRUE(updateCalled);
 }
 
+TEST_F(ArchetypeStoreTest, BatchedNotificationsAreDeliveredOncePerArchetype) {
+    std::vector<const Archetype *> adds;
+    std::vector<const Archetype *> updates;
+    store.getChangeNotifier()->subscribeToAdd([&](const auto archetype) { adds.push_back(archetype); });
+    store.getChangeNotifier()->subscribeToUpdate([&](const auto archetype) { updates.push_back(archetype); });
+
+    store.getChangeNotifier()->beginBatch();
+    for (Entity entity = 1; entity <= 100; ++entity) {
+        store.setComponents(entity, Position{0, 0});
+        store.setComponents(entity, Velocity{1, 1});
+    }
+    EXPECT_TRUE(adds.empty());
+    EXPECT_TRUE(updates.empty());
+    store.getChangeNotifier()->endBatch();
+
+    // Delivered once each, in the order the archetypes were first touched.
+    ASSERT_EQ(adds.size(), 2);
+    EXPECT_EQ(adds[0]->getSignature().count(), 2);
+    EXPECT_EQ(adds[1]->getSignature().count(), 3);
+    ASSERT_EQ(updates.size(), 2);
+    EXPECT_EQ(updates[0], adds[0]);
+    EXPECT_EQ(updates[1], adds[1]);
+}
+
 TEST_F(ArchetypeStoreTest, FindArchetypesReturnsMatches) {
     store.setComponents(entity1, Position{1, 2});
     store.setComponents(entity2, Position{3, 4}, Velocity{1, 1});
 
-    auto signature = Signature();
-    signature.set(1);
+    // {Entity, Position}, whatever ids the two were given.
+    const auto signature = store.getSignature(entity1);
     const auto results = store.findArchetypes(signature, {});
 
     EXPECT_EQ(results.size(), 2);
-}
\ No newline at end of file
+}
+
+TEST_F(ArchetypeStoreTest, RegisteredQueriesTrackNewArchetypes) {
+    store.setComponents(entity1, Position{1, 2});
+    const auto positions = store.getSignature(entity1);
+    Signature excluding;
+    excluding.set(ArchetypeStore::getTypeIndex<Health>());
+
+    const auto *query = store.acquireQuery(positions, excluding);
+    EXPECT_EQ(store.acquireQuery(positions, excluding), query);
+    EXPECT_EQ(store.registeredQueryCount(), 1);
+    ASSERT_EQ(query->archetypes.size(), 1);
+
+    // New archetypes are matched as they appear; ones with the excluded component are not.
+    const auto version = query->version;
+    const Entity entity3{3};
+    store.setComponents(entity2, Position{3, 4}, Velocity{1, 1});
+    store.setComponents(entity3, Position{5, 6}, Health{1});
+    EXPECT_EQ(query->archetypes.size(), 2);
+    EXPECT_GT(query->version, version);
+
+    // Structural changes in a matching archetype bump the version; others leave it alone.
+    auto seen = query->version;
+    store.setComponents(entity3, Velocity{0, 0});
+    EXPECT_EQ(query->version, seen);
+    store.removeEntity(entity1);
+    EXPECT_GT(query->version, seen);
+
+    store.releaseQuery(query);
+    EXPECT_EQ(store.registeredQueryCount(), 1);
+    store.releaseQuery(query);
+    EXPECT_EQ(store.registeredQueryCount(), 0);
+}
+
+TEST_F(ArchetypeStoreTest, QueriesAcquiredDuringABatchLinkArchetypesOnce) {
+    store.getChangeNotifier()->beginBatch();
+    store.setComponents(entity1, Position{1, 2});
+    const auto *query = store.acquireQuery(store.getSignature(entity1), {});
+    ASSERT_EQ(query->archetypes.size(), 1);
+    store.getChangeNotifier()->endBatch();
+
+    // The held-back notification for the same archetype doesn't link it again.
+    EXPECT_EQ(query->archetypes.size(), 1);
+    store.releaseQuery(query);
+    EXPECT_EQ(store.registeredQueryCount(), 0);
+}
+
+TEST(SparseComponentViewTest, ExcludingOnlyViewsReuseOneRegisteredQuery) {
+    const auto store = std::make_unique<ArchetypeStore>();
+    store->setComponents(Entity{1}, Position{1, 1});
+    store->setComponents(Entity{2}, Position{2, 2}, Targeted{1});
+    Signature excluding;
+    excluding.set(ArchetypeStore::getTypeIndex<Targeted>());
+
+    float sum = 0;
+    {
+        const SparseComponentView<const Position> view(store, excluding);
+        for (int i = 0; i < 3; ++i) {
+            view.forEach([&](const Position &position) {
+                sum += position.x;
+                return true;
+            });
+        }
+        EXPECT_EQ(store->registeredQueryCount(), 1);
+
+        store->setComponents(Entity{3}, Position{4, 4}, Velocity{0, 0});
+        view.forEach([&](const Position &position) {
+            sum += position.x;
+            return true;
+        });
+        EXPECT_EQ(sum, 3 * 1.0f + 1.0f + 4.0f);
+    }
+    EXPECT_EQ(store->registeredQueryCount(), 0);
+}
+
+TEST_F(ArchetypeStoreTest, TransitionsAreCachedAsArchetypeEdges) {
+    store.setComponents(entity1, Position{1, 2});
+    const auto positionSignature = store.getSignature(entity1);
+    ASSERT_TRUE(store.setComponents(entity1, Velocity{3, 4}));
+    const auto bothSignature = store.getSignature(entity1);
+
+    const Archetype *from = nullptr;
+    const Archetype *to = nullptr;
+    for (const auto *archetype: store.findArchetypes(positionSignature, {})) {
+        if (archetype->getSignature() == positionSignature) {
+            from = archetype;
+        } else if (archetype->getSignature() == bothSignature) {
+            to = archetype;
+        }
+    }
+    ASSERT_NE(from, nullptr);
+    ASSERT_NE(to, nullptr);
+    const auto velocity = ArchetypeStore::getTypeIndex<Velocity>();
+    EXPECT_EQ(from->getAddEdge(velocity), to);
+    EXPECT_EQ(to->getRemoveEdge(velocity), from);
+
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(store.removeComponent<Velocity>(entity1));
+        EXPECT_EQ(store.getSignature(entity1), positionSignature);
+        ASSERT_TRUE(store.setComponents(entity1, Velocity{3, 4}));
+        EXPECT_EQ(store.getSignature(entity1), bothSignature);
+    }
+    EXPECT_EQ(store.findArchetypes(positionSignature, {}).size(), 2);
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1, 2}));
+    EXPECT_EQ(*store.getComponent<Velocity>(entity1), (Velocity{3, 4}));
+}
+
+TEST_F(ArchetypeStoreTest, EmptiedChunksAreRecycledAcrossArchetypes) {
+    const auto &pool = store.getChunkPool();
+    store.setComponents(entity1, Position{1, 2});
+    EXPECT_EQ(pool->getStats().chunksInUse, 1);
+
+    EXPECT_TRUE(store.removeEntity(entity1));
+    EXPECT_EQ(pool->getStats().chunksInUse, 0);
+    EXPECT_EQ(pool->getStats().chunksFree, 1);
+
+    store.setComponents(entity2, Velocity{1, 1});
+    const auto stats = pool->getStats();
+    EXPECT_EQ(stats.chunksInUse, 1);
+    EXPECT_EQ(stats.chunksFree, 0);
+    EXPECT_EQ(stats.peakChunksInUse, 1);
+    EXPECT_EQ(*store.getComponent<Velocity>(entity2), (Velocity{1, 1}));
+}
+
+TEST_F(ArchetypeStoreTest, ReleasingChunkKeepsRemainingEntitiesReachable) {
+    constexpr Entity kEntities = 40000;
+    for (Entity e = 1; e <= kEntities; ++e) {
+        store.setComponents(e, Health{static_cast<int>(e)});
+    }
+    const auto chunksBefore = store.getChunkPool()->getStats().chunksInUse;
+    ASSERT_GT(chunksBefore, 2);
+
+    for (Entity e = 1; e <= kEntities / 2; ++e) {
+        EXPECT_TRUE(store.removeEntity(e));
+    }
+    EXPECT_LT(store.getChunkPool()->getStats().chunksInUse, chunksBefore);
+
+    for (Entity e = kEntities / 2 + 1; e <= kEntities; ++e) {
+        const auto *health = store.getComponent<Health>(e);
+        ASSERT_NE(health, nullptr);
+        EXPECT_EQ(health->value, static_cast<int>(e));
+    }
+}
+
+TEST_F(ArchetypeStoreTest, MemoryBudgetLimitsChunks) {
+    store.getChunkPool()->setMemoryBudget(0);
+    EXPECT_FALSE(store.setComponents(entity1, Position{1, 2}));
+    EXPECT_EQ(store.getChunkPool()->getStats().failedAcquires, 1);
+}
+
+TEST_F(ArchetypeStoreTest, FailedRemoveComponentKeepsEntity) {
+    ASSERT_TRUE(store.setComponents(entity1, Position{1, 2}, Velocity{3, 4}, Targeted{7}));
+    const auto *pool = store.getChunkPool().get();
+    store.getChunkPool()->setMemoryBudget(pool->getStats().chunksInUse * pool->getChunkSize());
+
+    // The {Entity, Position, Targeted} archetype can't get a chunk, so nothing changes.
+    EXPECT_FALSE(store.removeComponent<Velocity>(entity1));
+    ASSERT_NE(store.getRecord(entity1).archetype, nullptr);
+    EXPECT_EQ(*store.getComponent<Position>(entity1), (Position{1, 2}));
+    EXPECT_EQ(*store.getComponent<Velocity>(entity1), (Velocity{3, 4}));
+    ASSERT_NE(store.getComponent<Targeted>(entity1), nullptr);
+    EXPECT_EQ(store.getComponent<Targeted>(entity1)->by, 7);
+}
+
+TEST_F(ArchetypeStoreTest, BulkMovesFitInATightMemoryBudget) {
+    constexpr Entity kEntities = 40000;
+    for (Entity e = 1; e <= kEntities; ++e) {
+        store.setComponents(e, Health{static_cast<int>(e)});
+    }
+    Signature healthy;
+    healthy.set(ArchetypeStore::getTypeIndex<Health>());
+    const auto *pool = store.getChunkPool().get();
+    const auto chunksBefore = pool->getStats().chunksInUse;
+    ASSERT_GT(chunksBefore, 2);
+
+    // Rows double in size, so the target needs about twice the chunks. Source chunks are released as they empty, so
+    // the move never holds both archetypes in full and fits in that much memory.
+    store.getChunkPool()->setMemoryBudget(2 * chunksBefore * pool->getChunkSize());
+    EXPECT_EQ(store.addComponentToAll(healthy, {}, Velocity{1, 1}), kEntities);
+    EXPECT_EQ(pool->getStats().failedAcquires, 0);
+    for (Entity e = 1; e <= kEntities; ++e) {
+        ASSERT_EQ(store.getComponent<Health>(e)->value, static_cast<int>(e));
+        ASSERT_NE(store.getComponent<Velocity>(e), nullptr);
+        ASSERT_EQ(*store.getComponent<Velocity>(e), (Velocity{1, 1}));
+    }
+}
+
+TEST_F(ArchetypeStoreTest, CompactReportsFillFactor) {
+    constexpr Entity kEntities = 60000;
+    for (Entity e = 1; e <= kEntities; ++e) {
+        store.setComponents(e, Health{static_cast<int>(e)});
+    }
+    for (Entity e = 1; e <= kEntities; e += 2) {
+        store.removeEntity(e);
+    }
+    const auto chunksBefore = store.getChunkPool()->getStats().chunksInUse;
+    const auto stats = store.compact();
+    EXPECT_LT(stats.fillFactorBefore, 0.6);
+    EXPECT_GT(stats.fillFactorAfter, stats.fillFactorBefore);
+    EXPECT_GT(stats.entitiesMoved, 0);
+    EXPECT_EQ(store.getChunkPool()->getStats().chunksInUse, chunksBefore - stats.chunksReleased);
+    for (Entity e = 2; e <= kEntities; e += 2) {
+        ASSERT_EQ(store.getComponent<Health>(e)->value, static_cast<int>(e));
+    }
+}
+
+TEST_F(ArchetypeStoreTest, CompactionPolicyKeepsArchetypesDense) {
+    constexpr Entity kEntities = 60000;
+    store.setCompactionPolicy(0.75, 64);
+    for (Entity e = 1; e <= kEntities; ++e) {
+        store.setComponents(e, Health{static_cast<int>(e)});
+    }
+    for (Entity e = 1; e <= kEntities; e += 2) {
+        store.removeEntity(e);
+    }
+    EXPECT_GE(store.getFillFactor(), 0.7);
+    for (Entity e = 2; e <= kEntities; e += 2) {
+        ASSERT_EQ(store.getComponent<Health>(e)->value, static_cast<int>(e));
+    }
+}
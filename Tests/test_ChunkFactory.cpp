@@ -16,6 +16,10 @@ struct B {
     float y;
 };
 
+struct C {
+    double values[8];
+};
+
 TEST(ChunkFactoryTest, BasicCreation) {
     std::vector<ComponentTypeInfo> types = {
         {0, sizeof(A), alignof(A)},
@@ -61,4 +65,64 @@ TEST(ChunkFactoryTest, BasicCreation) {
 
     EXPECT_FALSE(factory.canCreateChunk());
     EXPECT_FALSE(factory.create().has_value());
-}
\ No newline at end of file
+}
+
+TEST(ChunkFactoryTest, CommitsMemoryOnlyForCreatedChunks) {
+    auto registry = std::make_shared<ComponentRegistry>();
+    registry->registerComponent({0, sizeof(A), alignof(A)});
+
+    constexpr size_t chunkSize = 64 * 1024;
+    constexpr size_t chunkCount = 1024;
+    Signature bitset;
+    bitset.set(0);
+    ChunkFactory factory(bitset, registry, std::make_shared<Chunks::ChunkPool>(chunkSize, chunkCount, false), chunkCount);
+
+    EXPECT_EQ(factory.committedBytes(), 0);
+
+    auto first = factory.create();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_GE(factory.reservedBytes(), chunkSize * chunkCount);
+    EXPECT_GE(factory.committedBytes(), chunkSize);
+    EXPECT_LT(factory.committedBytes(), 2 * chunkSize);
+
+    auto second = factory.create();
+    ASSERT_TRUE(second.has_value());
+    EXPECT_GE(factory.committedBytes(), 2 * chunkSize);
+    EXPECT_LT(factory.committedBytes(), 3 * chunkSize);
+
+    auto *values = reinterpret_cast<A *>(second->components[0].ptr);
+    for (size_t i = 0; i < second->capacity; ++i) {
+        values[i].x = static_cast<int>(i);
+    }
+    EXPECT_EQ(values[second->capacity - 1].x, static_cast<int>(second->capacity - 1));
+}
+
+TEST(ChunkFactoryTest, ColdColumnsUseCompanionBlock) {
+    auto registry = std::make_shared<ComponentRegistry>();
+    registry->registerComponent({0, sizeof(A), alignof(A)});
+    registry->registerComponent({1, sizeof(C), alignof(C)});
+    Signature bitset;
+    bitset.set(0);
+    bitset.set(1);
+
+    constexpr size_t chunkSize = 16 * 1024;
+    auto pool = std::make_shared<Chunks::ChunkPool>(chunkSize, 16, false);
+    ChunkFactory together(bitset, registry, pool, 4);
+    EXPECT_TRUE(registry->setCold(1));
+    EXPECT_FALSE(registry->setCold(2));
+    ChunkFactory split(bitset, registry, pool, 4);
+
+    EXPECT_EQ(split.getBlocksPerChunk(), 2);
+    EXPECT_GT(split.getChunkCapacity(), together.getChunkCapacity());
+    EXPECT_EQ(split.getChunkCapacity(), chunkSize / sizeof(C));
+
+    const auto chunk = split.create();
+    ASSERT_TRUE(chunk.has_value());
+    ASSERT_NE(chunk->companion, nullptr);
+    EXPECT_EQ(chunk->components[1].ptr, chunk->companion);
+    EXPECT_GE(chunk->components[0].ptr, chunk->memory);
+    EXPECT_LE(chunk->components[0].ptr + chunk->capacity * sizeof(A), chunk->memory + chunkSize);
+    EXPECT_EQ(pool->getStats().chunksInUse, 2);
+    split.release(*chunk);
+    EXPECT_EQ(pool->getStats().chunksInUse, 0);
+}
@@ -0,0 +1,121 @@
+//
+//  test_ChunkPool.cpp
+//  AECS
+//
+
+#include <gtest/gtest.h>
+#include <fstream>
+#include <string>
+#include <ECS/Archetype/Chunks/ChunkPool.hpp>
+
+using namespace ECS::Chunks;
+
+TEST(ChunkPoolTest, ReusesReleasedChunks) {
+    ChunkPool pool(64 * 1024, 4);
+
+    char *first = pool.acquire();
+    char *second = pool.acquire();
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(first, second);
+
+    pool.release(first);
+    EXPECT_EQ(pool.getStats().chunksInUse, 1);
+    EXPECT_EQ(pool.getStats().chunksFree, 1);
+
+    EXPECT_EQ(pool.acquire(), first);
+    const auto stats = pool.getStats();
+    EXPECT_EQ(stats.chunksInUse, 2);
+    EXPECT_EQ(stats.chunksFree, 0);
+    EXPECT_EQ(stats.peakChunksInUse, 2);
+}
+
+TEST(ChunkPoolTest, GrowsBeyondOneArena) {
+    ChunkPool pool(4096, 2, false);
+    std::vector<char *> chunks;
+    for (auto i = 0; i < 5; ++i) {
+        chunks.push_back(pool.acquire());
+        ASSERT_NE(chunks.back(), nullptr);
+        std::memset(chunks.back(), i, 4096);
+    }
+    const auto stats = pool.getStats();
+    EXPECT_EQ(stats.chunksInUse, 5);
+    EXPECT_GE(stats.reservedBytes, 6 * 4096);
+    EXPECT_EQ(stats.committedBytes, 5 * 4096);
+}
+
+TEST(ChunkPoolTest, RespectsMemoryBudget) {
+    ChunkPool pool(64 * 1024, 16);
+    pool.setMemoryBudget(2 * 64 * 1024);
+
+    char *first = pool.acquire();
+    EXPECT_NE(first, nullptr);
+    EXPECT_NE(pool.acquire(), nullptr);
+    EXPECT_FALSE(pool.canAcquire());
+    EXPECT_EQ(pool.acquire(), nullptr);
+    EXPECT_EQ(pool.getStats().failedAcquires, 1);
+
+    pool.release(first);
+    EXPECT_NE(pool.acquire(), nullptr);
+}
+
+TEST(ChunkPoolTest, TrimDiscardsFreeChunks) {
+    ChunkPool pool(64 * 1024, 4, false);
+    char *chunk = pool.acquire();
+    ASSERT_NE(chunk, nullptr);
+    std::memset(chunk, 0xAB, 64 * 1024);
+    pool.release(chunk);
+    const auto committed = pool.getStats().committedBytes;
+
+    EXPECT_EQ(pool.trim(), 64 * 1024);
+    EXPECT_EQ(pool.getStats().committedBytes, committed - 64 * 1024);
+    // Already discarded chunks are not counted twice.
+    EXPECT_EQ(pool.trim(), 0);
+    EXPECT_EQ(pool.getStats().committedBytes, committed - 64 * 1024);
+
+    EXPECT_EQ(pool.acquire(), chunk);
+    EXPECT_EQ(pool.getStats().committedBytes, committed);
+    EXPECT_EQ(chunk[0], 0);
+}
+
+TEST(ChunkArenaTest, HugePagesFallBackCleanly) {
+    constexpr size_t chunkSize = 128 * 1024;
+    ChunkArena arena(chunkSize, 64, true);
+    ASSERT_GE(arena.reservedBytes(), chunkSize * 64);
+    EXPECT_EQ(arena.committedBytes(), 0);
+
+    char *chunk = arena.commit(3);
+    ASSERT_NE(chunk, nullptr);
+    std::memset(chunk, 0x5A, chunkSize);
+    EXPECT_GE(arena.committedBytes(), 4 * chunkSize);
+    EXPECT_EQ(chunk[chunkSize - 1], 0x5A);
+    EXPECT_LT(arena.committedBytes(), arena.reservedBytes());
+
+    if (arena.getPageKind() != PageKind::Regular) {
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(arena.commit(0)) % (2 * 1024 * 1024), 0);
+    }
+}
+
+TEST(ChunkArenaTest, HugeTLBCountsOnlyStepsBackedByHugePages) {
+    constexpr size_t chunkSize = 128 * 1024;
+    ChunkArena arena(chunkSize, 64, PageKind::HugeTLB);
+    EXPECT_EQ(arena.hugePageBytes(), 0);
+
+    char *chunk = arena.commit(20);
+    ASSERT_NE(chunk, nullptr);
+    std::memset(chunk, 0x5A, chunkSize);
+    EXPECT_LE(arena.hugePageBytes(), arena.committedBytes());
+
+    // With no free huge pages every step falls back to regular pages, and none of it counts as huge.
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line)) {
+        if (line.starts_with("HugePages_Free:") && std::stoul(line.substr(15)) == 0) {
+            EXPECT_EQ(arena.hugePageBytes(), 0);
+        }
+    }
+
+    ChunkPool pool(chunkSize, 4, false);
+    ASSERT_NE(pool.acquire(), nullptr);
+    EXPECT_EQ(pool.getStats().hugePageBytes, 0);
+}
@@ -0,0 +1,261 @@
+//
+//  test_EntityCommandBuffer.cpp
+//  AECS
+//
+
+#include <gtest/gtest.h>
+#include <thread>
+#include <ECS/EntityCommandBuffer.hpp>
+#include <ECS/ParallelCommandBuffer.hpp>
+
+using namespace ECS;
+
+namespace {
+    struct Health {
+        int value;
+    };
+
+    struct Poisoned {
+        int ticks;
+    };
+
+    struct Label {
+        char text[16];
+    };
+
+    // Every slot records as its own system; the threads are started in the given order.
+    std::vector<std::pair<Entity, int> > recordInParallel(const std::vector<size_t> &slots) {
+        EntityManager entityManager;
+        const auto entities = entityManager.createBatch<Health>(4096, [](const size_t index, Health &health) {
+            health.value = static_cast<int>(index);
+        });
+        ParallelCommandBuffer commands(entityManager, slots.size(), 128);
+        std::vector<std::thread> threads;
+        for (const auto slot: slots) {
+            threads.emplace_back([&, slot] {
+                auto &writer = commands.writer(slot);
+                for (uint32_t chunk = 0; chunk < 4; ++chunk) {
+                    writer.setSortKey(static_cast<uint32_t>(slot), chunk);
+                    for (size_t i = chunk * 1024; i < (chunk + 1) * 1024; i += slot + 1) {
+                        writer.setComponent(entities[i], Health{static_cast<int>(slot * 10000 + i)});
+                        if (i % 64 == 0) {
+                            writer.create(Health{-static_cast<int>(slot)}, Poisoned{static_cast<int>(chunk)});
+                        }
+                    }
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        commands.playback();
+
+        std::vector<std::pair<Entity, int> > state;
+        entityManager.createComponentView<Entity, const Health>().forEach([&](const Entity &entity, const Health &health) {
+            state.emplace_back(entity, health.value);
+            return true;
+        });
+        std::ranges::sort(state);
+        return state;
+    }
+}
+
+TEST(EntityCommandBufferTest, ChangesApplyOnlyOnPlayback) {
+    EntityManager entityManager;
+    const auto entities = entityManager.createBatch<Health>(1000, [](const size_t index, Health &health) {
+        health.value = static_cast<int>(index % 4);
+    });
+    EntityCommandBuffer commands(entityManager);
+
+    auto view = entityManager.createComponentView<Entity, const Health>();
+    view.forEach([&](const Entity &entity, const Health &health) {
+        if (health.value == 0) {
+            commands.remove(entity);
+        } else if (health.value == 1) {
+            commands.setComponent(entity, Poisoned{3});
+        }
+        return true;
+    });
+    EXPECT_EQ(commands.size(), 500);
+    EXPECT_NE(entityManager.getComponent<Health>(entities[0]), nullptr);
+    EXPECT_FALSE(entityManager.hasComponent<Poisoned>(entities[1]));
+
+    commands.playback();
+    EXPECT_TRUE(commands.empty());
+    for (size_t i = 0; i < entities.size(); ++i) {
+        ASSERT_EQ(entityManager.getComponent<Health>(entities[i]) != nullptr, i % 4 != 0);
+        ASSERT_EQ(entityManager.hasComponent<Poisoned>(entities[i]), i % 4 == 1);
+    }
+    EXPECT_EQ(entityManager.getComponent<Poisoned>(entities[1])->ticks, 3);
+}
+
+TEST(EntityCommandBufferTest, CommandsForOneEntityKeepTheirOrder) {
+    EntityManager entityManager;
+    const auto entity = entityManager.createWithComponents(Health{10});
+    EntityCommandBuffer commands(entityManager);
+    commands.setComponent(entity, Poisoned{1});
+    commands.setComponents(entity, Health{5}, Poisoned{2});
+    commands.removeComponent<Health>(entity);
+    commands.setComponent(entity, Label{"poisoned"});
+    commands.playback();
+
+    EXPECT_FALSE(entityManager.hasComponent<Health>(entity));
+    EXPECT_EQ(entityManager.getComponent<Poisoned>(entity)->ticks, 2);
+    EXPECT_STREQ(entityManager.getComponent<Label>(entity)->text, "poisoned");
+}
+
+TEST(EntityCommandBufferTest, CreateReservesIdsAndDestroyWins) {
+    EntityManager entityManager;
+    const auto existing = entityManager.createWithComponents(Health{1});
+    EntityCommandBuffer commands(entityManager);
+    const auto spawned = commands.create(Health{2}, Poisoned{4});
+    const auto discarded = commands.create(Health{3});
+    commands.remove(discarded);
+    commands.setComponent(existing, Poisoned{1});
+    commands.remove(existing);
+    EXPECT_NE(spawned, existing);
+    EXPECT_NE(spawned, discarded);
+    EXPECT_EQ(entityManager.getComponent<Health>(spawned), nullptr);
+
+    commands.playback();
+    EXPECT_EQ(entityManager.getComponent<Health>(spawned)->value, 2);
+    EXPECT_EQ(entityManager.getComponent<Poisoned>(spawned)->ticks, 4);
+    EXPECT_EQ(entityManager.getComponent<Health>(discarded), nullptr);
+    EXPECT_EQ(entityManager.getComponent<Health>(existing), nullptr);
+
+    const auto reused = entityManager.create();
+    EXPECT_TRUE(reused == discarded || reused == existing);
+}
+
+TEST(EntityCommandBufferTest, ClearDropsRecordedCommands) {
+    EntityManager entityManager;
+    const auto entity = entityManager.createWithComponents(Health{1});
+    EntityCommandBuffer commands(entityManager);
+    for (int i = 0; i < 10000; ++i) {
+        commands.setComponent(entity, Health{i});
+    }
+    commands.clear();
+    commands.playback();
+    EXPECT_EQ(entityManager.getComponent<Health>(entity)->value, 1);
+}
+
+TEST(EntityCommandBufferTest, ClearReturnsReservedIds) {
+    EntityManager entityManager;
+    std::vector<Entity> reserved;
+    {
+        EntityCommandBuffer commands(entityManager);
+        reserved.push_back(commands.create(Health{1}));
+        reserved.push_back(commands.create(Health{2}));
+        commands.clear();
+        reserved.push_back(commands.create(Health{3}));
+    }
+    // The last create() took an id that clear() had given back.
+    EXPECT_NE(std::ranges::find(reserved.begin(), reserved.begin() + 2, reserved[2]), reserved.begin() + 2);
+    std::vector reused{entityManager.create(), entityManager.create()};
+    reserved.pop_back();
+    std::ranges::sort(reserved);
+    std::ranges::sort(reused);
+    EXPECT_EQ(reused, reserved);
+}
+
+TEST(EntityCommandBufferTest, BatchedPlaybackMatchesDirectCalls) {
+    const auto run = [](const bool buffered) {
+        EntityManager entityManager;
+        const auto entities = entityManager.createBatch<Health>(20000, [](const size_t index, Health &health) {
+            health.value = static_cast<int>(index);
+        });
+        for (size_t i = 0; i < entities.size(); i += 7) {
+            entityManager.setComponent(entities[i], Poisoned{-1});
+        }
+        EntityCommandBuffer commands(entityManager);
+        for (size_t i = 0; i < entities.size(); ++i) {
+            const auto entity = entities[i];
+            const int value = static_cast<int>(i);
+            if (buffered) {
+                commands.setComponent(entity, Poisoned{value});
+            } else {
+                entityManager.setComponent(entity, Poisoned{value});
+            }
+            // The same entity shows up twice within one run of commands.
+            if (i % 5 == 0) {
+                if (buffered) {
+                    commands.setComponent(entities[i / 2], Poisoned{value * 2});
+                } else {
+                    entityManager.setComponent(entities[i / 2], Poisoned{value * 2});
+                }
+            }
+        }
+        // Recorded against row order, so the rows have to be sorted before they move.
+        for (size_t n = (entities.size() + 2) / 3; n-- > 0;) {
+            if (buffered) {
+                commands.removeComponent<Health>(entities[n * 3]);
+            } else {
+                entityManager.removeComponent<Health>(entities[n * 3]);
+            }
+        }
+        commands.playback();
+
+        std::vector<std::tuple<Entity, int, int> > state;
+        for (const auto entity: entities) {
+            const auto *health = entityManager.getComponent<Health>(entity);
+            state.emplace_back(entity, health ? health->value : -1, entityManager.getComponent<Poisoned>(entity)->ticks);
+        }
+        return state;
+    };
+    EXPECT_EQ(run(true), run(false));
+}
+
+TEST(EntityCommandBufferTest, ParallelWritersMergeBySortKey) {
+    EntityManager entityManager;
+    const auto entity = entityManager.createWithComponents(Health{0});
+    ParallelCommandBuffer commands(entityManager, 2);
+    commands.writer(0).setSortKey(2);
+    commands.writer(0).setComponent(entity, Health{2});
+    commands.writer(1).setSortKey(1);
+    commands.writer(1).setComponent(entity, Health{1});
+    commands.writer(1).setComponent(entity, Poisoned{1});
+    EXPECT_EQ(commands.size(), 3);
+
+    commands.playback();
+    EXPECT_EQ(commands.size(), 0);
+    EXPECT_EQ(entityManager.getComponent<Health>(entity)->value, 2);
+    EXPECT_EQ(entityManager.getComponent<Poisoned>(entity)->ticks, 1);
+}
+
+TEST(EntityCommandBufferTest, ParallelPlaybackIsReproducible) {
+    const auto expected = recordInParallel({0, 1, 2, 3});
+    EXPECT_GT(expected.size(), 4096);
+    EXPECT_EQ(recordInParallel({3, 2, 1, 0}), expected);
+    EXPECT_EQ(recordInParallel({1, 3, 0, 2}), expected);
+}
+
+TEST(EntityCommandBufferTest, ParallelWritersCreateUniqueIds) {
+    EntityManager entityManager;
+    constexpr size_t kThreads = 8;
+    constexpr size_t kPerThread = 5000;
+    ParallelCommandBuffer commands(entityManager, kThreads, 64);
+    std::vector<std::vector<Entity> > created(kThreads);
+    std::vector<std::thread> threads;
+    for (size_t slot = 0; slot < kThreads; ++slot) {
+        threads.emplace_back([&, slot] {
+            for (size_t i = 0; i < kPerThread; ++i) {
+                created[slot].push_back(commands.writer(slot).create(Health{static_cast<int>(slot)}));
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+    commands.playback();
+
+    std::vector<Entity> all;
+    for (size_t slot = 0; slot < kThreads; ++slot) {
+        for (const auto entity: created[slot]) {
+            ASSERT_EQ(entityManager.getComponent<Health>(entity)->value, static_cast<int>(slot));
+            all.push_back(entity);
+        }
+    }
+    std::ranges::sort(all);
+    EXPECT_EQ(std::ranges::adjacent_find(all), all.end());
+    EXPECT_EQ(all.size(), kThreads * kPerThread);
+}
@@ -0,0 +1,617 @@
+//
+//  test_EntityManager.cpp
+//  AECS
+//
+
+#include <gtest/gtest.h>
+#include <ECS/EntityManager.hpp>
+#include <ECS/System/SystemComponentView.hpp>
+
+using namespace ECS;
+
+namespace {
+    struct Transform {
+        float x, y;
+        bool operator==(const Transform &other) const { return x == other.x && y == other.y; }
+    };
+
+    struct Tint {
+        int value;
+        bool operator==(const Tint &other) const { return value == other.value; }
+    };
+
+    struct Marker {
+        int value;
+    };
+
+    struct Selected {
+    };
+
+    struct Team {
+        static constexpr bool kShared = true;
+        int id;
+    };
+
+    struct Buff {
+        static constexpr bool kSparse = true;
+        int power;
+    };
+
+    struct Stunned {
+        static constexpr bool kSparse = true;
+    };
+
+    struct Awake {
+        static constexpr bool kEnableable = true;
+        int ticks;
+    };
+
+    struct Extent {
+        static constexpr bool kChunk = true;
+        float minX = 0.0f;
+        float maxX = -1.0f;
+    };
+
+    struct History {
+        static constexpr bool kCold = true;
+        int id;
+        double samples[15];
+    };
+
+    struct Waypoint {
+        static constexpr ComponentType kComponentID = 9;
+        float x, y;
+    };
+
+    struct Route {
+        int length;
+    };
+}
+
+ECS_COMPONENT_ID(Route, 10);
+
+TEST(EntityManagerTest, CreateBatchRunsInitForEveryEntity) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 20000;
+    const auto entities = entityManager.createBatch<Transform, Tint>(kCount, [](const size_t index, Transform &transform, Tint &tint) {
+        transform = {static_cast<float>(index), 1.0f};
+        tint.value = static_cast<int>(index) * 2;
+    });
+    ASSERT_EQ(entities.size(), kCount);
+    for (size_t i = 0; i < kCount; ++i) {
+        ASSERT_EQ(*entityManager.getComponent<Transform>(entities[i]), (Transform{static_cast<float>(i), 1.0f}));
+        ASSERT_EQ(*entityManager.getComponent<Tint>(entities[i]), (Tint{static_cast<int>(i) * 2}));
+    }
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<Transform, Tint>();
+    view.forEach([&](const Transform &, const Tint &) {
+        ++visited;
+        return true;
+    });
+    EXPECT_EQ(visited, kCount);
+}
+
+TEST(EntityManagerTest, CreateBatchCopiesSpans) {
+    EntityManager entityManager;
+    const std::vector<Transform> transforms{{1, 2}, {3, 4}, {5, 6}};
+    const std::vector<Tint> tints{{7}, {8}, {9}};
+    const auto entities = entityManager.createBatch<Transform, Tint>(transforms, tints);
+    ASSERT_EQ(entities.size(), transforms.size());
+    for (size_t i = 0; i < entities.size(); ++i) {
+        EXPECT_EQ(*entityManager.getComponent<Transform>(entities[i]), transforms[i]);
+        EXPECT_EQ(*entityManager.getComponent<Tint>(entities[i]), tints[i]);
+    }
+}
+
+TEST(EntityManagerTest, CreateBatchReusesRemovedIds) {
+    EntityManager entityManager;
+    const auto first = entityManager.createWithComponents(Tint{1});
+    const auto second = entityManager.createWithComponents(Tint{2});
+    entityManager.remove(first);
+
+    const auto entities = entityManager.createBatch<Tint>(3, [](const size_t index, Tint &tint) { tint.value = static_cast<int>(index); });
+    ASSERT_EQ(entities.size(), 3);
+    EXPECT_EQ(entities[0], first);
+    EXPECT_NE(entities[1], second);
+    EXPECT_NE(entities[2], second);
+    EXPECT_EQ(entityManager.getComponent<Tint>(second)->value, 2);
+    EXPECT_EQ(entityManager.getComponent<Tint>(entities[2])->value, 2);
+}
+
+TEST(EntityManagerTest, InstantiateClonesPrefabRow) {
+    EntityManager entityManager;
+    const auto prefab = entityManager.createWithComponents(Transform{1, 2}, Tint{3});
+    constexpr size_t kCount = 20000;
+    const auto clones = entityManager.instantiate(prefab, kCount);
+    ASSERT_EQ(clones.size(), kCount);
+    for (const auto clone: clones) {
+        ASSERT_NE(clone, prefab);
+        ASSERT_EQ(*entityManager.getComponent<Transform>(clone), (Transform{1, 2}));
+        ASSERT_EQ(*entityManager.getComponent<Tint>(clone), (Tint{3}));
+    }
+    entityManager.getComponent<Tint>(clones.back())->value = 4;
+    EXPECT_EQ(entityManager.getComponent<Tint>(prefab)->value, 3);
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<Entity, Tint>();
+    view.forEach([&](const Entity &, const Tint &) {
+        ++visited;
+        return true;
+    });
+    EXPECT_EQ(visited, kCount + 1);
+}
+
+TEST(EntityManagerTest, DestroyAllReleasesMatchingArchetypes) {
+    EntityManager entityManager;
+    const auto tinted = entityManager.createBatch<Transform, Tint>(20000, [](size_t, Transform &, Tint &) {});
+    const auto plain = entityManager.createWithComponents(Transform{1, 1});
+    const auto chunksBefore = entityManager.getMemoryStats().chunksInUse;
+
+    EXPECT_EQ(entityManager.destroyAll(EntityManager::Query<Tint>{}), tinted.size());
+    EXPECT_LT(entityManager.getMemoryStats().chunksInUse, chunksBefore);
+    EXPECT_EQ(entityManager.getComponent<Tint>(tinted.front()), nullptr);
+    EXPECT_FALSE(entityManager.hasComponent<Transform>(tinted.back()));
+    EXPECT_EQ(*entityManager.getComponent<Transform>(plain), (Transform{1, 1}));
+
+    const auto reused = entityManager.create();
+    EXPECT_NE(std::ranges::find(tinted, reused), tinted.end());
+}
+
+TEST(EntityManagerTest, DestroyRemovesEntitiesMatchingPredicate) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 20000;
+    const auto entities = entityManager.createBatch<Transform, Tint>(kCount, [](const size_t index, Transform &transform, Tint &tint) {
+        transform.x = static_cast<float>(index);
+        tint.value = static_cast<int>(index % 3);
+    });
+    const auto untouched = entityManager.createWithComponents(Tint{0});
+
+    const auto destroyed = entityManager.destroy(EntityManager::Query<const Tint>{}, EntityManager::Query<>{}, [](const Tint &tint) {
+        return tint.value == 0;
+    });
+    EXPECT_EQ(destroyed, (kCount + 2) / 3 + 1);
+    EXPECT_EQ(entityManager.getComponent<Tint>(untouched), nullptr);
+
+    for (size_t i = 0; i < kCount; ++i) {
+        const auto *tint = entityManager.getComponent<Tint>(entities[i]);
+        if (i % 3 == 0) {
+            ASSERT_EQ(tint, nullptr);
+            continue;
+        }
+        ASSERT_NE(tint, nullptr);
+        ASSERT_EQ(tint->value, static_cast<int>(i % 3));
+        ASSERT_EQ(entityManager.getComponent<Transform>(entities[i])->x, static_cast<float>(i));
+    }
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<Tint>();
+    view.forEach([&](const Tint &tint) {
+        visited += tint.value != 0;
+        return true;
+    });
+    EXPECT_EQ(visited, kCount - (kCount + 2) / 3);
+}
+
+TEST(EntityManagerTest, AddComponentToAllMovesMatchingArchetypes) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 40000;
+    const auto moving = entityManager.createBatch<Transform>(kCount, [](const size_t index, Transform &transform) {
+        transform.x = static_cast<float>(index);
+    });
+    const auto tinted = entityManager.createBatch<Transform, Tint>(kCount, [](const size_t index, Transform &transform, Tint &tint) {
+        transform.y = static_cast<float>(index);
+        tint.value = static_cast<int>(index);
+    });
+    const auto excluded = entityManager.createWithComponents(Tint{5});
+    const auto marked = entityManager.createWithComponents(Transform{0, 0}, Marker{1});
+
+    EXPECT_EQ(entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<>{}, Marker{7}), kCount * 2 + 1);
+    for (size_t i = 0; i < kCount; ++i) {
+        ASSERT_EQ(entityManager.getComponent<Marker>(moving[i])->value, 7);
+        ASSERT_EQ(entityManager.getComponent<Transform>(moving[i])->x, static_cast<float>(i));
+        ASSERT_EQ(entityManager.getComponent<Marker>(tinted[i])->value, 7);
+        ASSERT_EQ(*entityManager.getComponent<Tint>(tinted[i]), (Tint{static_cast<int>(i)}));
+        ASSERT_EQ(entityManager.getComponent<Transform>(tinted[i])->y, static_cast<float>(i));
+    }
+    EXPECT_EQ(entityManager.getComponent<Marker>(marked)->value, 7);
+    EXPECT_FALSE(entityManager.hasComponent<Marker>(excluded));
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<Transform, Marker>();
+    view.forEach([&](const Transform &, const Marker &) {
+        ++visited;
+        return true;
+    });
+    EXPECT_EQ(visited, kCount * 2 + 1);
+}
+
+TEST(EntityManagerTest, RemoveComponentFromAllKeepsOtherColumns) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 20000;
+    const auto entities = entityManager.createBatch<Transform, Tint>(kCount, [](const size_t index, Transform &transform, Tint &tint) {
+        transform.x = static_cast<float>(index);
+        tint.value = static_cast<int>(index);
+    });
+    const auto kept = entityManager.createWithComponents(Tint{1}, Marker{2});
+
+    EXPECT_EQ(entityManager.removeComponentFromAll<Tint>(EntityManager::Query<Transform>{}), kCount);
+    for (size_t i = 0; i < kCount; ++i) {
+        ASSERT_FALSE(entityManager.hasComponent<Tint>(entities[i]));
+        ASSERT_EQ(entityManager.getComponent<Transform>(entities[i])->x, static_cast<float>(i));
+    }
+    EXPECT_EQ(entityManager.getComponent<Tint>(kept)->value, 1);
+}
+
+TEST(EntityManagerTest, TagsFilterViewsWithoutColumns) {
+    EntityManager entityManager;
+    const auto entities = entityManager.createBatch<Transform, Selected>(1000, [](const size_t index, Transform &transform, Selected &) {
+        transform.x = static_cast<float>(index);
+    });
+    const auto plain = entityManager.createWithComponents(Transform{-1, 0});
+    const auto tagged = entityManager.createWithComponents(Transform{-2, 0}, Selected{});
+    entityManager.removeComponent<Selected>(entities[0]);
+    entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<Selected>{}, Tint{3});
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentViewWithQuery(EntityManager::Query<const Transform>{}, EntityManager::Query<>{}, EntityManager::Query<Selected>{});
+    view.forEach([&](const Transform &transform) {
+        visited += transform.x >= 0 || transform.x == -2;
+        return true;
+    });
+    EXPECT_EQ(visited, entities.size());
+    EXPECT_FALSE(entityManager.hasComponent<Selected>(plain));
+    EXPECT_TRUE(entityManager.hasComponent<Selected>(tagged));
+    EXPECT_EQ(entityManager.getComponent<Tint>(entities[0])->value, 3);
+    EXPECT_FALSE(entityManager.hasComponent<Tint>(entities[1]));
+
+    EXPECT_EQ(entityManager.destroyAll(EntityManager::Query<Selected>{}), entities.size());
+    EXPECT_NE(entityManager.getComponent<Transform>(plain), nullptr);
+}
+
+TEST(EntityManagerTest, SharedComponentsGroupChunksByValue) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 30000;
+    const auto entities = entityManager.createBatch<Transform>(kCount, [](const size_t index, Transform &transform) {
+        transform.x = static_cast<float>(index);
+    });
+    for (size_t i = 0; i < kCount; ++i) {
+        entityManager.setComponent(entities[i], Team{static_cast<int>(i % 3)});
+    }
+    entityManager.setComponent(entities[0], Team{2});
+    entityManager.setComponent(entities[1], Tint{5});
+    entityManager.removeComponent<Team>(entities[2]);
+    const auto clones = entityManager.instantiate(entities[3], 100);
+
+    const auto expectedTeam = [&](const Transform &transform) {
+        const auto index = static_cast<size_t>(transform.x);
+        return index == 0 ? 2 : static_cast<int>(index % 3);
+    };
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<const Transform, const Team>();
+    view.forEach([&](const Transform &transform, const Team &team) {
+        visited += team.id == expectedTeam(transform);
+        return true;
+    });
+    EXPECT_EQ(visited, kCount - 1 + clones.size());
+
+    // Each chunk holds a single team, so the value can be read once per chunk.
+    size_t rows = 0;
+    view.forEachChunk([&](const size_t count, const Transform *transforms, const Team *team) {
+        for (size_t i = 0; i < count; ++i) {
+            rows += team->id == expectedTeam(transforms[i]);
+        }
+    });
+    EXPECT_EQ(rows, visited);
+
+    EXPECT_EQ(entityManager.getComponent<Team>(entities[1])->id, 1);
+    EXPECT_EQ(entityManager.getComponent<Tint>(entities[1])->value, 5);
+    EXPECT_EQ(entityManager.getComponent<Transform>(entities[2])->x, 2.0f);
+    EXPECT_EQ(entityManager.getComponent<Team>(entities[4]), entityManager.getComponent<Team>(entities[7]));
+    EXPECT_NE(entityManager.getComponent<Team>(entities[4]), entityManager.getComponent<Team>(entities[5]));
+}
+
+TEST(EntityManagerTest, BulkMovesAndCompactionKeepSharedGroups) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 20000;
+    const auto entities = entityManager.createBatch<Transform>(kCount, [](const size_t index, Transform &transform) {
+        transform.x = static_cast<float>(index);
+    });
+    EXPECT_EQ(entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<>{}, Team{1}), kCount);
+    for (size_t i = 0; i < kCount; i += 2) {
+        entityManager.setComponent(entities[i], Team{0});
+    }
+    for (size_t i = 0; i < kCount; i += 3) {
+        entityManager.remove(entities[i]);
+    }
+    entityManager.compact();
+    EXPECT_EQ(entityManager.addComponentToAll(EntityManager::Query<Team>{}, EntityManager::Query<>{}, Tint{4}), kCount - (kCount + 2) / 3);
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<const Transform, const Team, const Tint>();
+    view.forEach([&](const Transform &transform, const Team &team, const Tint &tint) {
+        visited += team.id == (static_cast<size_t>(transform.x) % 2 == 0 ? 0 : 1) && tint.value == 4;
+        return true;
+    });
+    EXPECT_EQ(visited, kCount - (kCount + 2) / 3);
+
+    EXPECT_EQ(entityManager.removeComponentFromAll<Team>(EntityManager::Query<Tint>{}), visited);
+    EXPECT_FALSE(entityManager.hasComponent<Team>(entities[1]));
+    EXPECT_EQ(entityManager.getComponent<Transform>(entities[1])->x, 1.0f);
+}
+
+TEST(EntityManagerTest, AddComponentToAllOverwritesSharedValues) {
+    EntityManager entityManager;
+    const auto first = entityManager.createWithComponents(Transform{1, 1}, Team{1});
+    const auto second = entityManager.createWithComponents(Transform{2, 2}, Team{2});
+    EXPECT_NE(entityManager.getComponent<Team>(first), entityManager.getComponent<Team>(second));
+
+    EXPECT_EQ(entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<>{}, Team{7}), 2);
+    EXPECT_EQ(entityManager.getComponent<Team>(first)->id, 7);
+    EXPECT_EQ(entityManager.getComponent<Team>(second)->id, 7);
+    // Both chunks now hold the same value, so they were merged into one.
+    EXPECT_EQ(entityManager.getComponent<Team>(first), entityManager.getComponent<Team>(second));
+    EXPECT_EQ(entityManager.getComponent<Transform>(first)->x, 1.0f);
+    EXPECT_EQ(entityManager.getComponent<Transform>(second)->x, 2.0f);
+
+    size_t chunks = 0;
+    entityManager.createComponentView<const Transform, const Team>().forEachChunk([&](const size_t, const Transform *, const Team *) {
+        ++chunks;
+        return true;
+    });
+    EXPECT_EQ(chunks, 1);
+}
+
+TEST(EntityManagerTest, ChunkComponentsSkipWholeChunks) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 30000;
+    entityManager.createBatch<Transform>(kCount, [](const size_t index, Transform &transform) {
+        transform.x = static_cast<float>(index);
+    });
+    EXPECT_EQ(entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<>{}, Extent{}), kCount);
+
+    auto bounds = entityManager.createComponentView<const Transform, Extent>();
+    size_t chunks = 0;
+    bounds.forEachChunk([&](const size_t count, const Transform *transforms, Extent *extent) {
+        EXPECT_GT(extent->minX, extent->maxX);
+        *extent = {transforms[0].x, transforms[0].x};
+        for (size_t i = 1; i < count; ++i) {
+            extent->minX = std::min(extent->minX, transforms[i].x);
+            extent->maxX = std::max(extent->maxX, transforms[i].x);
+        }
+        ++chunks;
+    });
+    ASSERT_GT(chunks, 2);
+
+    constexpr float kMin = 1000.0f;
+    constexpr float kMax = 1010.0f;
+    size_t visited = 0;
+    size_t inside = 0;
+    auto view = entityManager.createComponentView<const Transform>();
+    view.forEach<Extent>([&](const Extent &extent) { return extent.maxX >= kMin && extent.minX <= kMax; }, [&](const Transform &transform) {
+        ++visited;
+        inside += transform.x >= kMin && transform.x <= kMax;
+        return true;
+    });
+    EXPECT_EQ(inside, 11);
+    EXPECT_LT(visited, kCount / 2);
+
+    // Views over archetypes without the chunk component see no chunks to test.
+    entityManager.createWithComponents(Transform{kMin, 0.0f}, Tint{1});
+    auto tinted = entityManager.createComponentView<const Transform, const Tint>();
+    EXPECT_FALSE(tinted.forEach<Extent>([](const Extent &) { return true; }, [](const Transform &, const Tint &) { return true; }));
+}
+
+TEST(EntityManagerTest, SparseComponentsJoinArchetypeColumns) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 1000;
+    const auto entities = entityManager.createBatch<Transform>(kCount, [](const size_t index, Transform &transform) {
+        transform.x = static_cast<float>(index);
+    });
+    for (size_t i = 0; i < kCount; i += 10) {
+        entityManager.setComponent(entities[i], Buff{static_cast<int>(i)});
+    }
+    for (size_t i = 0; i < kCount; i += 20) {
+        entityManager.setComponent(entities[i], Stunned{});
+    }
+    entityManager.setComponent(entities[10], Tint{1});
+    const auto clones = entityManager.instantiate(entities[20], 3);
+    entityManager.remove(entities[30]);
+    entityManager.destroyAll(EntityManager::Query<Tint>{});
+
+    size_t buffed = 0;
+    auto view = entityManager.createComponentView<const Transform, Buff>();
+    view.forEach([&](const Transform &transform, Buff &buff) {
+        EXPECT_EQ(static_cast<float>(buff.power), transform.x);
+        ++buff.power;
+        ++buffed;
+        return true;
+    });
+    EXPECT_EQ(buffed, kCount / 10 - 2 + clones.size());
+    EXPECT_EQ(entityManager.getComponent<Buff>(entities[40])->power, 41);
+    EXPECT_TRUE(entityManager.hasComponent<Stunned>(clones[0]));
+
+    size_t active = 0;
+    auto notStunned = entityManager.createComponentViewWithQuery(EntityManager::Query<const Transform, const Buff>{},
+                                                                 EntityManager::Query<Stunned>{});
+    notStunned.forEach([&](const Transform &transform, const Buff &) {
+        active += static_cast<size_t>(transform.x) % 20 != 0;
+        return true;
+    });
+    EXPECT_EQ(active, kCount / 20 - 2);
+
+    size_t stunned = 0;
+    auto stunnedTransforms = entityManager.createComponentViewWithQuery(EntityManager::Query<const Transform>{}, EntityManager::Query<>{},
+                                                                        EntityManager::Query<Stunned>{});
+    stunnedTransforms.forEach([&](const Transform &) {
+        ++stunned;
+        return true;
+    });
+    EXPECT_EQ(stunned, kCount / 20 + clones.size());
+
+    size_t calm = 0;
+    auto calmTransforms = entityManager.createComponentViewWithQuery(EntityManager::Query<const Transform>{}, EntityManager::Query<Stunned>{});
+    calmTransforms.forEach([&](const Transform &) {
+        ++calm;
+        return true;
+    });
+    EXPECT_EQ(calm, kCount - 2 - kCount / 20);
+
+    EXPECT_EQ(entityManager.removeComponentFromAll<Stunned>(EntityManager::Query<Transform>{}), kCount / 20 + clones.size());
+    EXPECT_EQ(entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<>{}, Buff{0}), kCount - 2 + clones.size());
+    EXPECT_EQ(entityManager.getComponent<Buff>(entities[1])->power, 0);
+}
+
+TEST(EntityManagerTest, ViewsSkipDisabledComponents) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 10000;
+    const auto entities = entityManager.createBatch<Transform, Awake>(kCount, [](const size_t index, Transform &transform, Awake &) {
+        transform.x = static_cast<float>(index);
+    });
+    const auto sleeping = [](const size_t index) { return index % 3 == 0 || (index >= 4096 && index < 4096 + 200); };
+    size_t expected = 0;
+    for (size_t i = 0; i < kCount; ++i) {
+        entityManager.setEnabled<Awake>(entities[i], !sleeping(i));
+        expected += !sleeping(i);
+    }
+    // Moves whole archetypes, swaps rows on removal and clones a disabled prefab.
+    entityManager.addComponentToAll(EntityManager::Query<Transform>{}, EntityManager::Query<>{}, Tint{1});
+    for (size_t i = 1; i < kCount; i += 7) {
+        entityManager.remove(entities[i]);
+        expected -= !sleeping(i);
+    }
+    entityManager.compact();
+    const auto clones = entityManager.instantiate(entities[0], 50);
+    EXPECT_FALSE(entityManager.isEnabled<Awake>(clones[0]));
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<const Transform, Awake>();
+    view.forEach([&](const Transform &transform, Awake &awake) {
+        EXPECT_FALSE(sleeping(static_cast<size_t>(transform.x)));
+        ++awake.ticks;
+        ++visited;
+        return true;
+    });
+    EXPECT_EQ(visited, expected);
+
+    size_t iterated = 0;
+    for (const auto &[transform, awake]: view) {
+        EXPECT_EQ(awake.ticks, 1);
+        ++iterated;
+    }
+    EXPECT_EQ(iterated, expected);
+
+    // Views that don't iterate the component see everyone.
+    size_t all = 0;
+    auto transforms = entityManager.createComponentView<const Transform>();
+    transforms.forEach([&](const Transform &) {
+        ++all;
+        return true;
+    });
+    EXPECT_EQ(all, kCount - (kCount + 5) / 7 + clones.size());
+}
+
+TEST(EntityManagerTest, ColdColumnsStayAlignedWithTheirRows) {
+    EntityManager entityManager;
+    constexpr size_t kCount = 20000;
+    const auto entities = entityManager.createBatch<Transform, History>(kCount, [](const size_t index, Transform &transform, History &history) {
+        transform.x = static_cast<float>(index);
+        history.id = static_cast<int>(index);
+        history.samples[14] = static_cast<double>(index) * 0.5;
+    });
+    // Removals swap rows, migrations copy them to another archetype, compaction moves them between chunks.
+    for (size_t i = 0; i < kCount; i += 3) {
+        entityManager.remove(entities[i]);
+    }
+    for (size_t i = 1; i < kCount; i += 3) {
+        entityManager.setComponent(entities[i], Tint{static_cast<int>(i)});
+    }
+    entityManager.compact();
+    const auto clones = entityManager.instantiate(entities[2], 10);
+    EXPECT_EQ(entityManager.getComponent<History>(clones[9])->id, 2);
+
+    for (size_t i = 1; i < kCount; ++i) {
+        if (i % 3 == 0) {
+            continue;
+        }
+        const auto *history = entityManager.getComponent<History>(entities[i]);
+        ASSERT_NE(history, nullptr);
+        EXPECT_EQ(history->id, static_cast<int>(i));
+        EXPECT_EQ(history->samples[14], static_cast<double>(i) * 0.5);
+    }
+
+    size_t visited = 0;
+    auto view = entityManager.createComponentView<const Transform, const History>();
+    view.forEach([&](const Transform &transform, const History &history) {
+        EXPECT_EQ(static_cast<int>(transform.x), history.id);
+        ++visited;
+        return true;
+    });
+    EXPECT_EQ(visited, kCount - (kCount + 2) / 3 + clones.size());
+}
+
+TEST(EntityManagerTest, StaticComponentIdsDontDependOnUseOrder) {
+    EntityManager entityManager;
+    const auto entity = entityManager.createWithComponents(Route{3}, Waypoint{1.0f, 2.0f}, Tint{4});
+    const auto &signature = entityManager.getSignature(entity);
+    EXPECT_TRUE(signature.test(0));
+    EXPECT_TRUE(signature.test(9));
+    EXPECT_TRUE(signature.test(10));
+    // Components without a static id are numbered after the reserved range.
+    EXPECT_EQ(signature.count(), 4);
+    EXPECT_GE(signature.highestBit, ECS_STATIC_COMPONENT_IDS);
+    EXPECT_EQ(entityManager.getComponent<Route>(entity)->length, 3);
+    EXPECT_EQ(entityManager.getComponent<Waypoint>(entity)->y, 2.0f);
+}
+
+namespace {
+    class BuffedTransformSystem final : public SystemComponentView<const Transform, const Buff> {
+    public:
+        using SystemComponentView::SystemComponentView;
+        size_t visited = 0;
+
+        bool update(float) override {
+            return componentView.forEach([&](const Transform &, const Buff &) {
+                ++visited;
+                return true;
+            });
+        }
+    };
+
+    ComponentViewSubscribed<Transform> makeTransformView(const EntityManager &entityManager) {
+        auto view = entityManager.createComponentView<Transform>();
+        size_t warm = 0;
+        view.forEach([&](Transform &) { return ++warm > 0; });
+        return view;
+    }
+}
+
+TEST(EntityManagerTest, MovedViewsFollowStructuralChanges) {
+    const auto entityManager = std::make_shared<EntityManager>();
+    entityManager->createWithComponents(Transform{1, 1});
+    auto views = std::vector<ComponentViewSubscribed<Transform> >();
+    views.push_back(makeTransformView(*entityManager));
+    views.push_back(makeTransformView(*entityManager));
+
+    // The views were moved twice; changes made afterwards must still reach them.
+    const auto tinted = entityManager->createWithComponents(Transform{2, 2}, Tint{1});
+    entityManager->createWithComponents(Transform{3, 3}, Buff{5});
+    for (auto &view: views) {
+        float sum = 0;
+        view.forEach([&](const Transform &transform) {
+            sum += transform.x;
+            return true;
+        });
+        EXPECT_EQ(sum, 6.0f);
+    }
+    entityManager->remove(tinted);
+    views.pop_back();
+    size_t count = 0;
+    views.front().forEach([&](Transform &) { return ++count > 0; });
+    EXPECT_EQ(count, 2);
+
+    // Systems accept sparse queries too.
+    BuffedTransformSystem system(entityManager);
+    system.update(0.0f);
+    EXPECT_EQ(system.visited, 1);
+}
@@ -0,0 +1,42 @@
+//
+//  test_EntityTable.cpp
+//  AECS
+//
+
+#include <gtest/gtest.h>
+#include <ECS/EntityTable.hpp>
+
+using namespace ECS;
+
+struct Slot {
+    int value = -1;
+};
+
+TEST(EntityTableTest, MissingEntitiesReadAsEmpty) {
+    const EntityTable<Slot, 64> table;
+    EXPECT_EQ(table.get(0).value, -1);
+    EXPECT_EQ(table.get(1000000).value, -1);
+    EXPECT_FALSE(table.contains(5));
+    EXPECT_EQ(table.pageCount(), 0);
+}
+
+TEST(EntityTableTest, AllocatesOnlyTouchedPages) {
+    EntityTable<Slot, 64> table;
+    table[3].value = 3;
+    table[64 * 100 + 1].value = 7;
+
+    EXPECT_EQ(table.pageCount(), 2);
+    EXPECT_EQ(table.get(3).value, 3);
+    EXPECT_EQ(table.get(64 * 100 + 1).value, 7);
+    EXPECT_EQ(table.get(64 * 50).value, -1);
+    EXPECT_TRUE(table.contains(64 * 100));
+    EXPECT_FALSE(table.contains(64 * 50));
+}
+
+TEST(EntityTableTest, GrowsPastInitialReservation) {
+    EntityTable<Slot> table(16);
+    const Entity large = std::numeric_limits<Entity>::max() - 1;
+    table[large].value = 42;
+    EXPECT_EQ(table.get(large).value, 42);
+    EXPECT_EQ(table.pageCount(), 1);
+}
@@ -0,0 +1,86 @@
+//
+//  test_SignatureBitset.cpp
+//  AECS
+//
+
+#include <gtest/gtest.h>
+#include <unordered_set>
+#include <vector>
+#include <ECS/Component/SignatureBitset.hpp>
+
+using namespace ECS;
+
+using Bits = SignatureBitset<192>;
+
+static Bits make(const std::vector<size_t> &bits) {
+    Bits signature;
+    for (const auto bit: bits) {
+        signature.set(bit);
+    }
+    return signature;
+}
+
+TEST(SignatureBitsetTest, VisitsSetBitsAcrossWordsInOrder) {
+    const auto signature = make({130, 0, 63, 64, 191, 5});
+    std::vector<size_t> visited;
+    signature.forEachSetBit([&](const uint16_t bit) { visited.push_back(bit); });
+    EXPECT_EQ(visited, (std::vector<size_t>{0, 5, 63, 64, 130, 191}));
+    EXPECT_EQ(signature.count(), 6);
+    EXPECT_EQ(signature.lowestBit, 0);
+    EXPECT_EQ(signature.highestBit, 191);
+}
+
+TEST(SignatureBitsetTest, ResetKeepsBoundsAndHash) {
+    auto signature = make({3, 70, 150});
+    signature.reset(3);
+    signature.reset(150);
+    EXPECT_EQ(signature.lowestBit, 70);
+    EXPECT_EQ(signature.highestBit, 70);
+    EXPECT_EQ(signature, make({70}));
+    EXPECT_EQ(std::hash<Bits>{}(signature), std::hash<Bits>{}(make({70})));
+    signature.reset(70);
+    EXPECT_TRUE(signature.none());
+    EXPECT_EQ(signature, Bits{});
+    EXPECT_EQ(signature.hash, 0);
+}
+
+TEST(SignatureBitsetTest, SetTestsCompareWholeWords) {
+    const auto archetype = make({0, 2, 65, 140});
+    EXPECT_TRUE(archetype.contains(make({2, 140})));
+    EXPECT_FALSE(archetype.contains(make({2, 141})));
+    EXPECT_TRUE(archetype.intersects(make({1, 65})));
+    EXPECT_FALSE(archetype.intersects(make({1, 66, 190})));
+    EXPECT_TRUE(archetype.matches(make({0, 65}), make({1, 139})));
+    EXPECT_FALSE(archetype.matches(make({0, 65}), make({140})));
+    EXPECT_TRUE(archetype.matches({}, {}));
+
+    EXPECT_EQ(archetype & make({2, 3, 140}), make({2, 140}));
+    EXPECT_EQ(make({1}) | make({100}), make({1, 100}));
+    EXPECT_EQ((make({1}) | make({100})).hash, make({100, 1}).hash);
+}
+
+TEST(SignatureBitsetTest, BuildsAtCompileTime) {
+    constexpr auto signature = [] {
+        Bits bits;
+        bits.set(1);
+        bits.set(129);
+        return bits;
+    }();
+    static_assert(signature.test(129) && signature.count() == 2);
+    EXPECT_EQ(signature, make({129, 1}));
+
+    std::unordered_set<Bits> seen{make({1}), make({1, 2}), make({2, 1})};
+    EXPECT_EQ(seen.size(), 2);
+}
+
+TEST(SignatureBitsetTest, RejectsBitsPastMaxComponents) {
+    // 100 bits round up to two words, so bit 120 would land in storage without the check.
+    SignatureBitset<100> bits;
+    bits.set(99);
+    EXPECT_TRUE(bits.test(99));
+#ifndef NDEBUG
+    EXPECT_DEATH(bits.set(120), "");
+    EXPECT_DEATH(bits.reset(100), "");
+    EXPECT_DEATH(static_cast<void>(bits.test(127)), "");
+#endif
+}
@@ -8,10 +8,10 @@
 #pragma once
 
 #include "Chunks/ChunkFactory.hpp"
+#include "EntityLocation.hpp"
 #include <algorithm>
 #include <ranges>
 #include "ComponentRegistry.hpp"
-#include <functional>
 #ifndef NDEBUG
 #include <cassert>
 #endif
@@ -19,48 +19,196 @@
 namespace ECS {
     using ComponentsRecord = std::array<void *, MAX_COMPONENTS>;
 
+    struct CompactionStats {
+        double fillFactorBefore = 1.0;
+        double fillFactorAfter = 1.0;
+        size_t entitiesMoved = 0;
+        size_t chunksReleased = 0;
+    };
+
     class Archetype final {
     public:
-        struct EntityLocation {
-            Chunks::Index chunkIndex{};
-            size_t indexInChunk{};
+        using EntityLocation = ECS::EntityLocation;
+        // One pointer per shared column, in getSharedColumns() order.
+        using SharedValues = std::span<const void *const>;
+
+        struct SharedColumn {
+            ComponentType type;
+            uint16_t size;
         };
 
     private:
         const Signature signature;
         const std::shared_ptr<ComponentRegistry> registry;
         const std::unique_ptr<ChunkFactory> chunkFactory;
+        const std::shared_ptr<EntityLocations> locations;
+        std::vector<ComponentType> columns;
+        std::vector<SharedColumn> sharedColumns;
+        std::vector<ComponentType> enableableColumns;
 
         size_t count;
 
+        static constexpr size_t kNotFree = std::numeric_limits<size_t>::max();
+
         std::vector<Chunks::Chunk> chunks;
-        std::vector<std::optional<EntityLocation> > entityLocations;
+
+        // Chunks with spare capacity, plus each chunk's position in that list (kNotFree when full).
+        std::vector<Chunks::Index> freeChunks;
+        std::vector<size_t> freeChunkSlots;
+
+        // Archetypes reached by adding or removing a single component type; filled lazily by the store.
+        struct Edge {
+            ComponentType type;
+            Archetype *add = nullptr;
+            Archetype *remove = nullptr;
+        };
+
+        std::vector<Edge> edges;
+
+        [[nodiscard]] const Edge *findEdge(const ComponentType type) const noexcept {
+            for (const auto &edge: edges) {
+                if (edge.type == type) {
+                    return &edge;
+                }
+            }
+            return nullptr;
+        }
+
+        Edge &edge(const ComponentType type) {
+            for (auto &edge: edges) {
+                if (edge.type == type) {
+                    return edge;
+                }
+            }
+            return edges.emplace_back(Edge{type});
+        }
+
+        void markFree(const Chunks::Index index) {
+            if (freeChunkSlots[index] != kNotFree) {
+                return;
+            }
+            freeChunkSlots[index] = freeChunks.size();
+            freeChunks.push_back(index);
+        }
+
+        void markFull(const Chunks::Index index) {
+            const auto slot = freeChunkSlots[index];
+            if (slot == kNotFree) {
+                return;
+            }
+            const auto last = freeChunks.back();
+            freeChunks[slot] = last;
+            freeChunkSlots[last] = slot;
+            freeChunks.pop_back();
+            freeChunkSlots[index] = kNotFree;
+        }
 
         bool addChunk() {
             if (const auto chunk = chunkFactory->create()) {
                 chunks.push_back(chunk.value());
+                freeChunkSlots.push_back(kNotFree);
+                markFree(chunks.size() - 1);
                 return true;
             }
             return false;
         }
 
-        void setEntityLocation(const Entity entity, EntityLocation &&location) noexcept {
-            if (entity >= entityLocations.size()) {
-                entityLocations.resize(entity + 1);
+        void releaseChunk(const Chunks::Index index) {
+            chunkFactory->release(chunks[index]);
+            markFull(index);
+            const Chunks::Index last = chunks.size() - 1;
+            if (index != last) {
+                chunks[index] = chunks[last];
+                freeChunkSlots[index] = freeChunkSlots[last];
+                if (freeChunkSlots[index] != kNotFree) {
+                    freeChunks[freeChunkSlots[index]] = index;
+                }
+                const auto &moved = chunks[index];
+                for (size_t i = 0; i < moved.size; ++i) {
+                    const Entity entity = *static_cast<const Entity *>(Chunks::get(moved, 0, i));
+                    setEntityLocation(entity, {index, i});
+                }
             }
-            entityLocations[entity] = std::forward<EntityLocation>(location);
-            for (auto& subscriber : entityAddressesSubscription) {
-                subscriber(entity, this, std::forward<EntityLocation>(location));
+            chunks.pop_back();
+            freeChunkSlots.pop_back();
+        }
+
+        [[nodiscard]] bool holds(const Chunks::Index index, const SharedValues values) const noexcept {
+            const auto &chunk = chunks[index];
+            for (size_t i = 0; i < sharedColumns.size(); ++i) {
+                if (std::memcmp(chunk.components[sharedColumns[i].type].ptr, values[i], sharedColumns[i].size) != 0) {
+                    return false;
+                }
             }
+            return true;
         }
 
-        void removeEntityLocation(const Entity entity) {
-            if (entity < entityLocations.size()) {
-                entityLocations[entity] = std::nullopt;
-            } else {
+        // A chunk with spare room whose shared components equal `values`; a new chunk gets `values` written into it.
+        std::optional<Chunks::Index> chunkFor(const SharedValues values) {
 #ifndef NDEBUG
-                throw std::runtime_error("removeEntityLocation: entity out of range");
+            assert(values.size() == sharedColumns.size());
 #endif
+            if (sharedColumns.empty()) {
+                if (freeChunks.empty() && !addChunk()) {
+                    return std::nullopt;
+                }
+                return freeChunks.back();
+            }
+            for (const auto index: freeChunks | std::views::reverse) {
+                if (holds(index, values)) {
+                    return index;
+                }
+            }
+            if (!addChunk()) {
+                return std::nullopt;
+            }
+            const auto &chunk = chunks.back();
+            for (size_t i = 0; i < sharedColumns.size(); ++i) {
+                std::memcpy(chunk.components[sharedColumns[i].type].ptr, values[i], sharedColumns[i].size);
+            }
+            return chunks.size() - 1;
+        }
+
+        // Rows appended to a chunk start with every component enabled; copies from another row overwrite the bits after.
+        void enableRows(const Chunks::Chunk &chunk, const Chunks::Index row, const size_t n) const noexcept {
+            for (const auto type: enableableColumns) {
+                Chunks::setBits(Chunks::enabledMask(chunk, type), row, n, true);
+            }
+        }
+
+        // Drops the row at `loc` by moving the chunk's last row into it; the removed entity's record is left alone.
+        void removeRow(const EntityLocation loc) {
+            auto &chunk = chunks[loc.chunkIndex];
+#ifndef NDEBUG
+            if (chunk.size == 0) {
+                throw std::runtime_error("Attempt to remove from an empty chunk");
+            }
+#endif
+            const size_t lastIndex = chunk.size - 1;
+            if (loc.indexInChunk != lastIndex) {
+                const Entity lastEntity = *static_cast<const Entity *>(Chunks::get(chunk, 0, lastIndex));
+                Chunks::swap(chunk, loc.indexInChunk, lastIndex);
+                setEntityLocation(lastEntity, {loc.chunkIndex, loc.indexInChunk});
+            }
+            --chunk.size;
+            --count;
+            if (chunk.size == 0) {
+                releaseChunk(loc.chunkIndex);
+            } else {
+                markFree(loc.chunkIndex);
+            }
+        }
+
+        void setEntityLocation(const Entity entity, const EntityLocation location) noexcept {
+            auto &record = (*locations)[entity];
+            record.archetype = this;
+            record.location = location;
+        }
+
+        void removeEntityLocation(const Entity entity) noexcept {
+            auto &record = (*locations)[entity];
+            if (record.archetype == this) {
+                record = {};
             }
         }
 
@@ -68,73 +216,411 @@ namespace ECS {
 #ifndef NDEBUG
             assert(entity == *static_cast<const Entity *>(data[0]));
 #endif
-            Chunks::Index index = chunks.size() - 1;
-            for (size_t i = 0; i < chunks.size(); ++i) {
-                Chunks::Chunk &chunk = chunks[index];
-                if (chunk.size < chunk.capacity) {
-                    Chunks::set(chunk, data, chunk.size);
-                    setEntityLocation(entity, {index, chunk.size});
-                    ++chunk.size;
-                    ++count;
-                    return true;
+            // The row's chunk is picked by the shared values found in `data`.
+            std::array<const void *, MAX_COMPONENTS> values{};
+            for (size_t i = 0; i < sharedColumns.size(); ++i) {
+                values[i] = data[sharedColumns[i].type];
+                if (!values[i]) {
+                    return false;
                 }
-                --index;
             }
-
-            if (!addChunk()) {
-                std::cout << "[ERROR] could not create new CHUNK!" << std::endl;
+            const auto location = emplace(entity, {values.data(), sharedColumns.size()});
+            if (!location.has_value()) {
                 return false;
             }
-
-            Chunks::Index last = chunks.size() - 1;
-            Chunks::Chunk &chunk = chunks[last];
-            Chunks::set(chunk, data, chunk.size);
-            setEntityLocation(entity, {last, chunk.size});
-            ++chunk.size;
-            ++count;
+            Chunks::set(chunks[location->chunkIndex], data, location->indexInChunk);
             return true;
         }
 
     public:
-        Archetype(const std::shared_ptr<ComponentRegistry> &registry, const Signature &signature, std::unique_ptr<ChunkFactory> chunkFactory)
-            : signature(signature), registry(registry), chunkFactory(std::move(chunkFactory)), count(0) {
-            chunks.reserve(this->chunkFactory->getChunkCount());
-            entityLocations.reserve(this->chunkFactory->getChunkCount() * this->chunkFactory->getChunkCapacity());
+        Archetype(const std::shared_ptr<ComponentRegistry> &registry, const Signature &signature, std::unique_ptr<ChunkFactory> chunkFactory,
+                  const std::shared_ptr<EntityLocations> &locations)
+            : signature(signature), registry(registry), chunkFactory(std::move(chunkFactory)), locations(locations), count(0) {
+            // Tags have no column, so migrations never copy them.
+            const auto &storage = this->chunkFactory->getStorageSignature();
+            columns.reserve(storage.count());
+            storage.forEachSetBit([&](const ComponentType type) { columns.push_back(type); });
+            this->chunkFactory->getSharedSignature().forEachSetBit([&](const ComponentType type) {
+                sharedColumns.push_back({type, registry->getType(type).size});
+            });
+            this->chunkFactory->getEnableableSignature().forEachSetBit([&](const ComponentType type) { enableableColumns.push_back(type); });
         }
 
         [[nodiscard]] const Signature &getSignature() const noexcept { return signature; }
         [[nodiscard]] size_t size() const noexcept { return count; }
         [[nodiscard]] uint16_t chunkCount() const noexcept { return chunks.size(); }
         [[nodiscard]] bool empty() const noexcept { return chunks.empty(); }
+        [[nodiscard]] size_t freeChunkCount() const noexcept { return freeChunks.size(); }
+        [[nodiscard]] size_t capacity() const noexcept { return chunks.size() * chunkFactory->getChunkCapacity(); }
+        [[nodiscard]] double fillFactor() const noexcept { return chunks.empty() ? 1.0 : static_cast<double>(count) / capacity(); }
+        [[nodiscard]] size_t memoryBytes() const noexcept {
+            return sizeof(Archetype) + chunks.capacity() * sizeof(Chunks::Chunk) + freeChunks.capacity() * sizeof(Chunks::Index) +
+                   freeChunkSlots.capacity() * sizeof(size_t) + chunks.size() * chunkFactory->getBlocksPerChunk() * chunkFactory->getPool()->getChunkSize();
+        }
+        [[nodiscard]] std::span<const ComponentType> getColumns() const noexcept { return columns; }
+        [[nodiscard]] std::span<const SharedColumn> getSharedColumns() const noexcept { return sharedColumns; }
         [[nodiscard]] const std::vector<Chunks::Chunk> &getChunks() const noexcept { return chunks; }
+        [[nodiscard]] const ChunkFactory &getChunkFactory() const noexcept { return *chunkFactory; }
         [[nodiscard]] const Chunks::Chunk &getChunk(const uint8_t index) const noexcept { return chunks[index]; }
         [[nodiscard]] const Chunks::Chunk &operator[](const std::size_t index) const noexcept { return chunks[index]; }
-        std::vector<std::function<void(Entity entity, Archetype *archetype, EntityLocation&& location)>> entityAddressesSubscription;
+
+        [[nodiscard]] Archetype *getAddEdge(const ComponentType type) const noexcept {
+            const auto *edge = findEdge(type);
+            return edge ? edge->add : nullptr;
+        }
+
+        [[nodiscard]] Archetype *getRemoveEdge(const ComponentType type) const noexcept {
+            const auto *edge = findEdge(type);
+            return edge ? edge->remove : nullptr;
+        }
+
+        void setAddEdge(const ComponentType type, Archetype *archetype) { edge(type).add = archetype; }
+        void setRemoveEdge(const ComponentType type, Archetype *archetype) { edge(type).remove = archetype; }
+
+        // Appends a row holding only `entity` and points the location table at it; other columns are left to the caller.
+        // The row goes to a chunk whose shared components equal `values`.
+        std::optional<EntityLocation> emplace(const Entity entity, const SharedValues values = {}) noexcept {
+            const auto chunkIndex = chunkFor(values);
+            if (!chunkIndex.has_value()) {
+                return std::nullopt;
+            }
+            const Chunks::Index index = chunkIndex.value();
+            Chunks::Chunk &chunk = chunks[index];
+            const EntityLocation location{index, chunk.size};
+            const auto &entities = chunk.components[0];
+            std::memcpy(entities.ptr + location.indexInChunk * entities.stride, &entity, sizeof(Entity));
+            enableRows(chunk, location.indexInChunk, 1);
+            ++chunk.size;
+            setEntityLocation(entity, location);
+            ++count;
+            if (chunk.size == chunk.capacity) {
+                markFull(index);
+            }
+            return location;
+        }
+
+        // Appends rows for `entities` one chunk at a time. `fill(chunk, row, first, n)` writes the remaining columns of
+        // rows [row, row + n), which hold entities[first, first + n). Returns how many entities were placed.
+        template<typename Fill>
+        size_t emplaceBatch(const std::span<const Entity> entities, Fill &&fill, const SharedValues values = {}) {
+            size_t placed = 0;
+            while (placed < entities.size()) {
+                const auto chunkIndex = chunkFor(values);
+                if (!chunkIndex.has_value()) {
+                    break;
+                }
+                const Chunks::Index index = chunkIndex.value();
+                Chunks::Chunk &chunk = chunks[index];
+                const size_t row = chunk.size;
+                const size_t n = std::min(entities.size() - placed, chunk.capacity - row);
+                const auto &column = chunk.components[0];
+                std::memcpy(column.ptr + row * column.stride, entities.data() + placed, n * sizeof(Entity));
+                for (size_t i = 0; i < n; ++i) {
+                    setEntityLocation(entities[placed + i], {index, row + i});
+                }
+                enableRows(chunk, row, n);
+                fill(chunk, row, placed, n);
+                chunk.size += n;
+                count += n;
+                placed += n;
+                if (chunk.size == chunk.capacity) {
+                    markFull(index);
+                }
+            }
+            return placed;
+        }
+
+        [[nodiscard]] bool isEnabled(const EntityLocation &location, const ComponentType type) const noexcept {
+            return Chunks::testBit(Chunks::enabledMask(chunks[location.chunkIndex], type), location.indexInChunk);
+        }
+
+        // Flips one bit of the column's enable mask; the row stays where it is.
+        void setEnabled(const EntityLocation &location, const ComponentType type, const bool enabled) const noexcept {
+            Chunks::setBit(Chunks::enabledMask(chunks[location.chunkIndex], type), location.indexInChunk, enabled);
+        }
+
+        void write(const EntityLocation &location, const ComponentType type, const void *data) const noexcept {
+            const auto &component = chunks[location.chunkIndex].components[type];
+            std::memcpy(component.ptr + location.indexInChunk * component.stride, data, component.stride);
+        }
+
+        // Copies `columns` of the row at `sourceLocation` in `source` into the row at `location`.
+        void copyFrom(const EntityLocation &location, const Archetype &source, const EntityLocation &sourceLocation,
+                      const std::span<const ComponentType> copiedColumns) const noexcept {
+            Chunks::copy(chunks[location.chunkIndex], location.indexInChunk, source.chunks[sourceLocation.chunkIndex], sourceLocation.indexInChunk,
+                         copiedColumns);
+        }
 
         bool remove(const Entity entity) {
             const auto location = getEntityLocation(entity);
             if (!location.has_value()) {
                 return false;
             }
-            const auto &loc = location.value();
-            auto &chunk = chunks[loc.chunkIndex];
-#ifndef NDEBUG
-            if (chunk.size == 0) {
-                throw std::runtime_error("Attempt to remove from an empty chunk");
-            }
-#endif
-            const size_t lastIndex = chunk.size - 1;
-            if (loc.indexInChunk != lastIndex) {
-                const Entity lastEntity = *static_cast<const Entity *>(Chunks::get(chunk, 0, lastIndex));
-                Chunks::swap(chunk, loc.indexInChunk, lastIndex);
-                setEntityLocation(lastEntity, {loc.chunkIndex, loc.indexInChunk});
-            }
+            return remove(entity, location.value());
+        }
+
+        // Removes the entity stored at `loc`; used during migrations, when the location table already points elsewhere.
+        bool remove(const Entity entity, const EntityLocation loc) {
             removeEntityLocation(entity);
-            --chunk.size;
-            --count;
+            removeRow(loc);
             return true;
         }
 
+        // Moves an entity of this archetype into a chunk holding `values`, e.g. after one of its shared components changed.
+        std::optional<EntityLocation> relocate(const Entity entity, const EntityLocation from, const SharedValues values) {
+            if (holds(from.chunkIndex, values)) {
+                return from;
+            }
+            const auto to = emplace(entity, values);
+            if (!to.has_value()) {
+                return std::nullopt;
+            }
+            Chunks::copy(chunks[to->chunkIndex], to->indexInChunk, chunks[from.chunkIndex], from.indexInChunk, getColumns().subspan(1));
+            removeRow(from);
+            // Releasing the emptied source chunk may have renumbered the destination.
+            return locations->get(entity).location;
+        }
+
+        // Moves every entity into `target` in runs, one memcpy per column in `columns` per run, taking rows off the end of
+        // this archetype's last chunk and releasing chunks as they empty. Target chunks are taken one at a time, after the
+        // emptied source chunk went back to the pool, so a move needs little more memory than the rows it moves.
+        // `fill(chunk, row, n)` initializes the target columns this archetype doesn't have; `added` is the value of a
+        // shared component only the target has. Returns how many entities were moved; on failure the rest stay here.
+        template<typename Fill>
+        size_t moveAllTo(Archetype &target, const std::span<const ComponentType> movedColumns, Fill &&fill, const void *added = nullptr) {
+            if (count == 0) {
+                return 0;
+            }
+            std::array<const void *, MAX_COMPONENTS> values{};
+            size_t moved = 0;
+            while (!chunks.empty()) {
+                const Chunks::Index sourceIndex = chunks.size() - 1;
+                auto &source = chunks[sourceIndex];
+                for (size_t i = 0; i < target.sharedColumns.size(); ++i) {
+                    const auto type = target.sharedColumns[i].type;
+                    values[i] = signature.test(type) ? source.components[type].ptr : added;
+                }
+                const auto index = target.chunkFor({values.data(), target.sharedColumns.size()});
+                if (!index.has_value()) {
+                    break;
+                }
+                auto &destination = target.chunks[index.value()];
+                const size_t n = std::min(source.size, destination.capacity - destination.size);
+                const size_t row = source.size - n;
+                const auto *entities = reinterpret_cast<const Entity *>(source.components[0].ptr);
+                target.enableRows(destination, destination.size, n);
+                Chunks::copy(destination, destination.size, source, row, n, movedColumns);
+                for (size_t i = 0; i < n; ++i) {
+                    target.setEntityLocation(entities[row + i], {index.value(), destination.size + i});
+                }
+                fill(static_cast<const Chunks::Chunk &>(destination), destination.size, n);
+                destination.size += n;
+                target.count += n;
+                if (destination.size == destination.capacity) {
+                    target.markFull(index.value());
+                }
+                source.size -= n;
+                count -= n;
+                moved += n;
+                if (source.size == 0) {
+                    releaseChunk(sourceIndex);
+                } else {
+                    markFree(sourceIndex);
+                }
+            }
+            return moved;
+        }
+
+        void fillColumn(const ComponentType type, const void *value) const {
+            for (const auto &chunk: chunks) {
+                Chunks::fill(chunk, type, 0, chunk.size, value);
+            }
+        }
+
+        // Writes `value` into every chunk's slot of the shared component `type`, then merges the chunks that now hold
+        // equal shared values.
+        void setShared(const ComponentType type, const void *value) {
+            const auto size = registry->getType(type).size;
+            for (const auto &chunk: chunks) {
+                std::memcpy(chunk.components[type].ptr, value, size);
+            }
+            compact();
+        }
+
+        // Removes every entity and hands all chunks back to the pool; the removed ids are appended to `removed`.
+        size_t clear(std::vector<Entity> &removed) {
+            const auto cleared = count;
+            for (const auto &chunk: chunks) {
+                const auto *entities = reinterpret_cast<const Entity *>(chunk.components[0].ptr);
+                removed.insert(removed.end(), entities, entities + chunk.size);
+                for (size_t row = 0; row < chunk.size; ++row) {
+                    removeEntityLocation(entities[row]);
+                }
+                chunkFactory->release(chunk);
+            }
+            chunks.clear();
+            freeChunks.clear();
+            freeChunkSlots.clear();
+            count = 0;
+            return cleared;
+        }
+
+        // Removes the rows for which `match(chunk, row)` holds, compacting each chunk in a single pass; chunks left
+        // empty are released. The removed ids are appended to `removed`.
+        template<typename Match>
+        size_t removeIf(Match &&match, std::vector<Entity> &removed) {
+            size_t removedCount = 0;
+            std::vector<Chunks::Index> emptied;
+            for (Chunks::Index index = 0; index < chunks.size(); ++index) {
+                auto &chunk = chunks[index];
+                const auto *entities = reinterpret_cast<const Entity *>(chunk.components[0].ptr);
+                size_t kept = 0;
+                for (size_t row = 0; row < chunk.size; ++row) {
+                    const Entity entity = entities[row];
+                    if (match(static_cast<const Chunks::Chunk &>(chunk), row)) {
+                        removeEntityLocation(entity);
+                        removed.push_back(entity);
+                        continue;
+                    }
+                    if (kept != row) {
+                        Chunks::copy(chunk, kept, chunk, row);
+                        setEntityLocation(entity, {index, kept});
+                    }
+                    ++kept;
+                }
+                const size_t dropped = chunk.size - kept;
+                if (dropped == 0) {
+                    continue;
+                }
+                removedCount += dropped;
+                count -= dropped;
+                chunk.size = kept;
+                if (kept == 0) {
+                    emptied.push_back(index);
+                } else {
+                    markFree(index);
+                }
+            }
+            for (const auto index: emptied | std::views::reverse) {
+                releaseChunk(index);
+            }
+            return removedCount;
+        }
+
+        // Removes the rows at `locations`, sorted and without repeats, whose entities already live in another archetype.
+        // Each hole is filled from the end of its chunk, so the cost follows the number of removed rows.
+        void removeRows(const std::span<const EntityLocation> locations) {
+            std::vector<Chunks::Index> emptied;
+            for (size_t begin = 0; begin < locations.size();) {
+                const auto index = locations[begin].chunkIndex;
+                size_t end = begin;
+                while (end < locations.size() && locations[end].chunkIndex == index) {
+                    ++end;
+                }
+                auto &chunk = chunks[index];
+                const auto *entities = reinterpret_cast<const Entity *>(chunk.components[0].ptr);
+                count -= end - begin;
+                size_t size = chunk.size;
+                for (size_t hole = begin, last = end; hole < last;) {
+                    if (locations[last - 1].indexInChunk == size - 1) {
+                        --last;
+                        --size;
+                        continue;
+                    }
+                    const auto row = locations[hole++].indexInChunk;
+                    Chunks::copy(chunk, row, chunk, --size);
+                    setEntityLocation(entities[row], {index, row});
+                }
+                chunk.size = size;
+                if (size == 0) {
+                    emptied.push_back(index);
+                } else {
+                    markFree(index);
+                }
+                begin = end;
+            }
+            for (const auto index: emptied | std::views::reverse) {
+                releaseChunk(index);
+            }
+        }
+
+        // Moves entities from the sparsest chunks into the densest non-full ones and releases the chunks left empty.
+        // Returns the number of entities moved, at most maxMoves.
+        size_t compact(const size_t maxMoves = std::numeric_limits<size_t>::max()) {
+            if (freeChunks.size() < 2 || maxMoves == 0) {
+                return 0;
+            }
+            std::vector<Chunks::Index> order(freeChunks.begin(), freeChunks.end());
+            // Entities only move between chunks holding the same shared values.
+            std::vector<size_t> groups(chunks.size(), 0);
+            if (!sharedColumns.empty()) {
+                std::vector<const void *> values(sharedColumns.size());
+                std::vector<Chunks::Index> representatives;
+                for (const auto index: order) {
+                    size_t group = 0;
+                    for (; group < representatives.size(); ++group) {
+                        for (size_t i = 0; i < sharedColumns.size(); ++i) {
+                            values[i] = chunks[representatives[group]].components[sharedColumns[i].type].ptr;
+                        }
+                        if (holds(index, values)) {
+                            break;
+                        }
+                    }
+                    if (group == representatives.size()) {
+                        representatives.push_back(index);
+                    }
+                    groups[index] = group;
+                }
+            }
+            std::ranges::sort(order, [&](const auto lhs, const auto rhs) {
+                return groups[lhs] != groups[rhs] ? groups[lhs] < groups[rhs] : chunks[lhs].size < chunks[rhs].size;
+            });
+
+            size_t moved = 0;
+            for (size_t begin = 0; begin < order.size() && moved < maxMoves;) {
+                size_t end = begin;
+                while (end < order.size() && groups[order[end]] == groups[order[begin]]) {
+                    ++end;
+                }
+                size_t source = begin;
+                size_t destination = end - 1;
+                while (source < destination && moved < maxMoves) {
+                    auto &from = chunks[order[source]];
+                    auto &to = chunks[order[destination]];
+                    if (to.size == to.capacity) {
+                        --destination;
+                        continue;
+                    }
+                    if (from.size == 0) {
+                        ++source;
+                        continue;
+                    }
+                    const Chunks::Index last = from.size - 1;
+                    const Entity entity = *static_cast<const Entity *>(Chunks::get(from, 0, last));
+                    Chunks::copy(to, to.size, from, last);
+                    setEntityLocation(entity, {order[destination], to.size});
+                    ++to.size;
+                    --from.size;
+                    ++moved;
+                }
+                begin = end;
+            }
+
+            std::vector<Chunks::Index> emptied;
+            for (const auto index: order) {
+                if (chunks[index].size == 0) {
+                    emptied.push_back(index);
+                } else if (chunks[index].size == chunks[index].capacity) {
+                    markFull(index);
+                }
+            }
+            std::ranges::sort(emptied, std::greater{});
+            for (const auto index: emptied) {
+                releaseChunk(index);
+            }
+            return moved;
+        }
+
         [[nodiscard]] ComponentsRecord getComponentRecord(Entity entity) const {
             ComponentsRecord record{};
             record[0] = &entity;
@@ -154,28 +640,21 @@ namespace ECS {
             }
             const auto &[chunkIndex, index] = location.value();
             const auto &chunk = chunks[chunkIndex];
-            for (auto i = signature.lowestBit; i <= signature.highestBit; i++) {
-                if (signature[i]) {
-                    record[i] = Chunks::get(chunk, i, index);
-                }
-            }
+            signature.forEachSetBit([&](const ComponentType i) { record[i] = Chunks::get(chunk, i, index); });
             return true;
         }
 
         [[nodiscard]] std::optional<EntityLocation> getEntityLocation(const Entity entity) const {
-            if (entity < entityLocations.size()) {
-                return entityLocations[entity];
+            const auto &record = locations->get(entity);
+            if (record.archetype != this) {
+                return std::nullopt;
             }
-            return std::nullopt;
+            return record.location;
         }
 
         [[nodiscard]] bool fillComponentRecordByLocation(std::span<void *> record, const EntityLocation& location) const {
             const auto &chunk = chunks[location.chunkIndex];
-            for (auto i = signature.lowestBit; i <= signature.highestBit; i++) {
-                if (signature[i]) {
-                    record[i] = Chunks::get(chunk, i, location.indexInChunk);
-                }
-            }
+            signature.forEachSetBit([&](const ComponentType i) { record[i] = Chunks::get(chunk, i, location.indexInChunk); });
             return true;
         }
 
@@ -14,13 +14,21 @@
 namespace ECS {
     class ArchetypeFactory final {
         const std::shared_ptr<ComponentRegistry> registry;
+        const std::shared_ptr<Chunks::ChunkPool> pool;
+        const std::shared_ptr<EntityLocations> locations;
 
     public:
-        explicit ArchetypeFactory(const std::shared_ptr<ComponentRegistry>& registry): registry(registry) { }
+        explicit ArchetypeFactory(const std::shared_ptr<ComponentRegistry>& registry,
+                                  const std::shared_ptr<Chunks::ChunkPool>& pool = std::make_shared<Chunks::ChunkPool>(),
+                                  const std::shared_ptr<EntityLocations>& locations = std::make_shared<EntityLocations>())
+            : registry(registry), pool(pool), locations(locations) { }
+
+        [[nodiscard]] const std::shared_ptr<Chunks::ChunkPool> &getChunkPool() const { return pool; }
+        [[nodiscard]] const std::shared_ptr<EntityLocations> &getEntityLocations() const { return locations; }
 
         [[nodiscard]] std::unique_ptr<Archetype> createArchetypeDynamic(const Signature &signature) const
         {
-            return std::make_unique<Archetype>(registry, signature, std::make_unique<ChunkFactory>(signature, registry, CHUNK_SIZE, MAX_CHUNK_COUNT));
+            return std::make_unique<Archetype>(registry, signature, std::make_unique<ChunkFactory>(signature, registry, pool, MAX_CHUNK_COUNT), locations);
         }
     };
 }
@@ -7,34 +7,44 @@
 
 #pragma once
 
+#include <algorithm>
+#include <future>
 #include <memory>
+#include <thread>
+#include <tuple>
 #include <utility>
 #include <ECS/Entity.h>
+#include <ECS/EntityTable.hpp>
 #include <ECS/Component/ComponentTypeID.hpp>
 #include "Archetype.hpp"
 #include "ArchetypeFactory.hpp"
 #include "ArchetypeStoreChangeNotifier.hpp"
 #include "ArrayPool.hpp"
 #include "ComponentRegistry.hpp"
+#include "QueryIndex.hpp"
+#include "SparseSet.hpp"
 
 namespace ECS {
     class ArchetypeStore final {
         static constexpr auto kEmptyComponents = std::array<ComponentTypeInfo, 0>();
 
-        struct EntityLocation {
-            Archetype * archetype = nullptr;
-            Archetype::EntityLocation location{};
-        };
-
-        static const Signature kEmptySignature;
+        static inline const Signature kEmptySignature{};
 
         ArrayPool<MAX_COMPONENTS, 4> recordsPool;
         std::unordered_map<Signature, std::unique_ptr<Archetype> > archetypes;
         const std::shared_ptr<ComponentRegistry> registry;
+        const std::shared_ptr<Chunks::ChunkPool> chunkPool;
+        const std::shared_ptr<EntityLocations> locations;
         const std::unique_ptr<ArchetypeStoreChangeNotifier> changeNotifier;
+        const std::unique_ptr<QueryIndex> queryIndex;
         const std::unique_ptr<ArchetypeFactory> factory;
+        EntityLocations &entitiesMap;
+        // One set per sparse component type, created on first use.
+        std::array<std::unique_ptr<SparseSet>, MAX_COMPONENTS> sparseSets;
+        std::vector<ComponentType> sparseTypes;
 
-        std::array<EntityLocation, MAX_ENTITIES> entitiesMap{};
+        double compactionFillFactor = 0.0;
+        size_t compactionMovesPerStep = 0;
 
         Archetype *getOrCreateArchetype(const Signature &bitmask) noexcept {
             if (bitmask.none()) {
@@ -45,52 +55,318 @@ namespace ECS {
                 return it->second.get();
             }
             auto archetype = factory->createArchetypeDynamic(bitmask);
-            archetype->entityAddressesSubscription.emplace_back([&](Entity entity, Archetype *arch, Archetype::EntityLocation&& location){
-                auto& address = entitiesMap[entity];
-                address.archetype = arch;
-                address.location = location;
-            });
             auto [newIt, _] = archetypes.emplace(bitmask, std::move(archetype));
             auto ptr = newIt->second.get();
             changeNotifier->notifyAdd(ptr);
             return ptr;
         }
 
-        void registerComponents(std::span<const ComponentInfo> &infos) const noexcept {
-            for (const auto &info: infos) { registry->registerComponent(info.type); }
+        static void connect(Archetype *from, Archetype *to, const ComponentType type) {
+            from->setAddEdge(type, to);
+            to->setRemoveEdge(type, from);
+        }
+
+        // Follows the cached edge for adding `type`, creating the target archetype the first time.
+        Archetype *getOrCreateAddTarget(Archetype *archetype, const ComponentType type) noexcept {
+            if (!archetype || archetype->getSignature().test(type)) {
+                return archetype;
+            }
+            if (auto *next = archetype->getAddEdge(type)) {
+                [[likely]] return next;
+            }
+            auto bitmask = archetype->getSignature();
+            bitmask.set(type);
+            auto *next = getOrCreateArchetype(bitmask);
+            if (next) {
+                connect(archetype, next, type);
+            }
+            return next;
+        }
+
+        // Follows the cached edge for removing `type`; nullptr when nothing would be left or the archetype can't be created.
+        Archetype *getOrCreateRemoveTarget(Archetype *archetype, const ComponentType type) noexcept {
+            if (auto *next = archetype->getRemoveEdge(type)) {
+                [[likely]] return next;
+            }
+            auto bitmask = archetype->getSignature();
+            bitmask.reset(type);
+            if (bitmask.none()) {
+                return nullptr;
+            }
+            auto *next = getOrCreateArchetype(bitmask);
+            if (next) {
+                connect(next, archetype, type);
+            }
+            return next;
         }
 
+        struct Migration {
+            Archetype *source;
+            Archetype *target;
+            std::span<const ComponentType> columns;
+        };
+
+        static constexpr size_t kParallelMigrationEntities = 1 << 16;
+
+        // Moves every source archetype into its target. Migrations sharing a target run on the same worker, so no two
+        // workers ever touch the same archetype; the chunk pool is the only shared state and it locks.
+        template<typename Fill>
+        size_t migrateAll(std::vector<Migration> &migrations, const Fill &fill, const void *added = nullptr) {
+            std::ranges::sort(migrations, std::less{}, &Migration::target);
+            std::vector<std::span<const Migration> > groups;
+            size_t entities = 0;
+            for (size_t begin = 0; begin < migrations.size();) {
+                size_t end = begin;
+                while (end < migrations.size() && migrations[end].target == migrations[begin].target) {
+                    entities += migrations[end++].source->size();
+                }
+                groups.emplace_back(migrations.data() + begin, end - begin);
+                begin = end;
+            }
+            const size_t workers = entities < kParallelMigrationEntities
+                                       ? 1
+                                       : std::clamp<size_t>(std::thread::hardware_concurrency(), 1, groups.size());
+            const auto run = [&](const size_t worker) {
+                size_t moved = 0;
+                for (size_t i = worker; i < groups.size(); i += workers) {
+                    for (const auto &migration: groups[i]) {
+                        moved += migration.source->moveAllTo(*migration.target, migration.columns, fill, added);
+                    }
+                }
+                return moved;
+            };
+            std::vector<std::future<size_t> > tasks;
+            for (size_t worker = 1; worker < workers; ++worker) {
+                tasks.push_back(std::async(std::launch::async, run, worker));
+            }
+            size_t moved = run(0);
+            for (auto &task: tasks) {
+                moved += task.get();
+            }
+            for (const auto &group: groups) {
+                for (const auto &migration: group) {
+                    changeNotifier->notifyUpdate(migration.source);
+                }
+                changeNotifier->notifyUpdate(group.front().target);
+            }
+            return moved;
+        }
+
+        struct BatchRow {
+            uint64_t key;
+            EntityLocation location;
+            size_t index;
+        };
+
+        // Collects the leading entities that live in the same archetype as the first one, stopping before the first entity
+        // listed twice, and returns that archetype. Rows are sorted by location; entities without one are keyed by id.
+        Archetype *collectRows(const std::span<const Entity> entities, std::vector<BatchRow> &rows) const {
+            auto *source = entitiesMap.get(entities[0]).archetype;
+            for (size_t i = 0; i < entities.size(); ++i) {
+                const auto record = entitiesMap.get(entities[i]);
+                if (record.archetype != source) {
+                    break;
+                }
+                const uint64_t key = source ? static_cast<uint64_t>(record.location.chunkIndex) << 32 | record.location.indexInChunk : entities[i];
+                rows.push_back({key, record.location, i});
+            }
+            // Commands recorded while iterating a view already come in row order.
+            if (!std::ranges::is_sorted(rows, std::less{}, &BatchRow::key)) {
+                std::ranges::sort(rows, std::less{}, &BatchRow::key);
+            }
+            size_t count = rows.size();
+            for (size_t i = 1; i < rows.size(); ++i) {
+                if (rows[i].key == rows[i - 1].key) {
+                    count = std::min(count, std::max(rows[i].index, rows[i - 1].index));
+                }
+            }
+            if (count != rows.size()) {
+                std::erase_if(rows, [count](const BatchRow &row) { return row.index >= count; });
+            }
+            return source;
+        }
+
+        // Rows can move as a block only when no shared column decides which chunk each of them lands in.
+        static bool canMoveRows(const Archetype *source, const Archetype *target, const size_t count) noexcept {
+            return count > 1 && target && target != source && target->getSharedColumns().empty() &&
+                   (!source || source->getSharedColumns().empty());
+        }
+
+        // Moves `rows`, which hold entities[0, rows.size()), from `source` into `target` one target chunk at a time and
+        // returns how many were placed. `fill(chunk, row, first, n)` writes the columns the source lacks.
+        template<typename Fill>
+        size_t moveRows(Archetype *source, Archetype *target, const std::span<const Entity> entities, const std::span<const BatchRow> rows,
+                        Fill &&fill) {
+            std::vector<EntityLocation> from(rows.size());
+            for (const auto &row: rows) {
+                from[row.index] = row.location;
+            }
+            // The target either adds columns to the source or drops some, so the smaller set is the one both share.
+            const auto columns = !source
+                                     ? std::span<const ComponentType>{}
+                                     : source->getColumns().size() <= target->getColumns().size()
+                                           ? source->getColumns()
+                                           : target->getColumns();
+            const auto copyRows = [&](const Chunks::Chunk &chunk, const size_t row, const size_t first, const size_t n) {
+                for (size_t i = 0; i < n && source; ++i) {
+                    const auto &location = from[first + i];
+                    Chunks::copy(chunk, row + i, (*source)[location.chunkIndex], location.indexInChunk, columns);
+                }
+                fill(chunk, row, first, n);
+            };
+            const auto placed = target->emplaceBatch(entities.first(rows.size()), copyRows);
+            if (source) {
+                std::vector<EntityLocation> moved;
+                moved.reserve(placed);
+                for (const auto &row: rows) {
+                    if (row.index < placed) {
+                        moved.push_back(row.location);
+                    }
+                }
+                source->removeRows(moved);
+                compactIfSparse(source);
+                changeNotifier->notifyUpdate(source);
+            }
+            if (placed > 0) {
+                changeNotifier->notifyUpdate(target);
+            }
+            return placed;
+        }
+
+        [[nodiscard]] static bool matches(const Signature &signature, const Signature &including, const Signature &excluding) noexcept {
+            return signature.matches(including, excluding);
+        }
+
+        template<typename Component>
+        [[nodiscard]] static Component &componentAt(const Chunks::Chunk &chunk, const Chunks::Index row) noexcept {
+            if constexpr (kIsTag<Component>) {
+                return tagInstance<Component>;
+            }
+            const auto &column = chunk.components[ComponentTypeID::get<Component>()];
+            return *reinterpret_cast<Component *>(column.ptr + row * column.stride);
+        }
+
+        // Shared values are written when their chunk is picked; a chunk component set through an entity overwrites the
+        // value of the entity's chunk.
+        template<typename Component>
+        static void write(const Archetype *archetype, const EntityLocation &location, const Component &component) noexcept {
+            if constexpr (kIsChunkComponent<Component>) {
+                writeChunk((*archetype)[location.chunkIndex], component);
+            } else if constexpr (!kIsTag<Component> && !kIsShared<Component>) {
+                archetype->write(location, ComponentTypeID::get<Component>(), &component);
+            }
+        }
+
+        template<typename Component>
+        static void writeChunk(const Chunks::Chunk &chunk, const Component &component) noexcept {
+            std::memcpy(chunk.components[ComponentTypeID::get<Component>()].ptr, &component, sizeof(Component));
+        }
+
+        template<typename Component>
+        [[nodiscard]] static Component *column(const Chunks::Chunk &chunk, const Chunks::Index row) noexcept {
+            if constexpr (kIsTag<Component>) {
+                return nullptr;
+            }
+            return reinterpret_cast<Component *>(chunk.components[ComponentTypeID::get<Component>()].ptr) + row;
+        }
+
+        template<typename Component>
+        static void writeRow(const Chunks::Chunk &chunk, const Chunks::Index row, const Component &component) noexcept {
+            if constexpr (!kIsTag<Component>) {
+                std::memcpy(column<Component>(chunk, row), &component, sizeof(Component));
+            }
+        }
+
+        using SharedBuffer = std::array<const void *, MAX_COMPONENTS>;
+
+        // Values for `target`'s shared columns: the components being set win over those in the entity's current chunk.
         template<typename... Components>
-        void fillComponentsRecord(std::span<void *> record, Components &&... components) noexcept {
-            ((registry->registerComponent(ComponentTypeID::getTypeInfo<Components>()),
-              record[ComponentTypeID::get<Components>()] = &components), ...);
+        static Archetype::SharedValues sharedValues(const Archetype &target, const EntityRecord &prev, SharedBuffer &buffer,
+                                                    const Components &... components) noexcept {
+            const auto shared = target.getSharedColumns();
+            for (size_t i = 0; i < shared.size(); ++i) {
+                const auto type = shared[i].type;
+                const void *value = prev.archetype && prev.archetype->getSignature().test(type)
+                                        ? prev.archetype->getComponentByLocation(prev.location, type)
+                                        : nullptr;
+                ((value = kIsShared<Components> && ComponentTypeID::get<Components>() == type ? static_cast<const void *>(&components) : value), ...);
+                buffer[i] = value;
+            }
+            return {buffer.data(), shared.size()};
+        }
+
+        template<typename Component>
+        SparseSet &sparseSet() {
+            static_assert(alignof(Component) <= alignof(std::max_align_t), "Sparse components can't be over-aligned");
+            const auto type = ComponentTypeID::get<Component>();
+            auto &set = sparseSets[type];
+            if (!set) {
+                set = std::make_unique<SparseSet>(kIsTag<Component> ? 0 : sizeof(Component));
+                sparseTypes.push_back(type);
+            }
+            return *set;
+        }
+
+        template<typename Component>
+        void setSparse(const Entity entity, const Component &component) {
+            if constexpr (kIsSparse<Component>) {
+                sparseSet<std::decay_t<Component> >().set(entity, kIsTag<Component> ? nullptr : &component);
+            }
+        }
+
+        // A one-element tuple for components stored in archetypes, an empty one for sparse components.
+        template<typename Component>
+        static auto archetypeComponent(Component &component) noexcept {
+            if constexpr (kIsSparse<Component>) {
+                return std::tuple<>{};
+            } else {
+                return std::tuple<Component &>{component};
+            }
+        }
+
+        void dropSparse(const std::span<const Entity> entities) noexcept {
+            for (const auto type: sparseTypes) {
+                for (const auto entity: entities) {
+                    sparseSets[type]->erase(entity);
+                }
+            }
         }
 
-        static void migrateEntity(
-            const Entity entity,
-            Archetype *prevArchetype,
-            Archetype *nextArchetype,
-            const std::span<void *> record
-        ) {
-            nextArchetype->set(record);
-            if (prevArchetype != nullptr && prevArchetype != nextArchetype) {
-                prevArchetype->remove(entity);
+        void compactIfSparse(Archetype *archetype) {
+            if (compactionMovesPerStep == 0 || archetype->fillFactor() >= compactionFillFactor) {
+                return;
             }
+            archetype->compact(compactionMovesPerStep);
+        }
+
+        void registerComponents(std::span<const ComponentInfo> &infos) const noexcept {
+            for (const auto &info: infos) { registry->registerComponent(info.type); }
+        }
+
+        template<typename... Components>
+        void registerComponents() const noexcept {
+            (registry->registerComponent(ComponentTypeID::getTypeInfo<std::decay_t<Components> >()), ...);
         }
 
     public:
-        ArchetypeStore() : registry(std::make_shared<ComponentRegistry>()), changeNotifier(std::make_unique<ArchetypeStoreChangeNotifier>()),
-                           factory(std::make_unique<ArchetypeFactory>(registry)) {
+        ArchetypeStore() : registry(std::make_shared<ComponentRegistry>()), chunkPool(std::make_shared<Chunks::ChunkPool>()),
+                           locations(std::make_shared<EntityLocations>(MAX_ENTITIES)),
+                           changeNotifier(std::make_unique<ArchetypeStoreChangeNotifier>()), queryIndex(std::make_unique<QueryIndex>()),
+                           factory(std::make_unique<ArchetypeFactory>(registry, chunkPool, locations)), entitiesMap(*locations) {
             registry->registerComponent(ComponentTypeID::getTypeInfo<Entity>());
+            // Registered queries learn about archetypes through the notifier, so batching delays them like any subscriber.
+            changeNotifier->subscribeToAdd([index = queryIndex.get()](const Archetype *archetype) { index->onAdd(archetype); });
+            changeNotifier->subscribeToUpdate([index = queryIndex.get()](const Archetype *archetype) { index->onUpdate(archetype); });
         }
 
         [[nodiscard]] const std::unique_ptr<ArchetypeStoreChangeNotifier> &getChangeNotifier() const { return changeNotifier; }
+        [[nodiscard]] const std::shared_ptr<Chunks::ChunkPool> &getChunkPool() const { return chunkPool; }
 
         [[nodiscard]] std::vector<const Archetype *> findArchetypes(const Signature &signature, const Signature &excluding) const noexcept {
             std::vector<const Archetype *> results;
             results.reserve(archetypes.size());
             for (const auto &[bitset, archetype]: archetypes) {
-                if ((bitset.bitset & signature.bitset) == signature.bitset && (bitset.bitset & excluding.bitset) == 0) {
+                if (matches(bitset, signature, excluding)) {
                     const Archetype *archetypePtr = archetype.get();
                     results.push_back(archetypePtr);
                 }
@@ -98,72 +374,366 @@ namespace ECS {
             return results;
         }
 
+        // Shares one registered query between all views asking for the same sets; only the first one scans the archetypes.
+        // Every acquireQuery needs a matching releaseQuery.
+        [[nodiscard]] const RegisteredQuery *acquireQuery(const Signature &including, const Signature &excluding) {
+            auto *query = queryIndex->find(including, excluding);
+            if (!query) {
+                query = queryIndex->add(including, excluding, findArchetypes(including, excluding));
+            }
+            ++query->users;
+            return query;
+        }
+
+        void releaseQuery(const RegisteredQuery *query) {
+            queryIndex->release(query);
+        }
+
+        [[nodiscard]] size_t registeredQueryCount() const noexcept { return queryIndex->size(); }
+
         template<typename... Components>
         bool setComponents(Entity entity, Components &&... components) {
-            static const auto componentsBitmask = SignatureID<Components...>::signature();
-            auto *prevArchetype = entitiesMap[entity].archetype;
-            Signature bitmask = componentsBitmask;
-            auto record = ComponentsRecord{};
-            record[0] = &entity;
-            if (prevArchetype) {
-                bitmask |= prevArchetype->getSignature();
-                if (!prevArchetype->fillComponentRecord(record)) {
+            if constexpr ((kIsSparse<Components> || ...)) {
+                // Sparse components only need the entity to exist; the rest go through the archetypes as usual.
+                registerComponents<Components...>();
+                const bool placed = std::apply([&](auto &... stored) {
+                    return (sizeof...(stored) == 0 && entitiesMap.get(entity).archetype) || setComponents(entity, stored...);
+                }, std::tuple_cat(archetypeComponent(components)...));
+                if (!placed) {
                     return false;
                 }
+                (setSparse(entity, components), ...);
+                return true;
+            }
+            const auto &componentsBitmask = SignatureID<Entity, Components...>::cached();
+            registerComponents<Components...>();
+            const auto prev = entitiesMap.get(entity);
+            auto *prevArchetype = prev.archetype;
+            Archetype *nextArchetype = nullptr;
+            if (prevArchetype) {
+                nextArchetype = prevArchetype;
+                ((nextArchetype = getOrCreateAddTarget(nextArchetype, ComponentTypeID::get<Components>())), ...);
+            } else {
+                nextArchetype = getOrCreateArchetype(componentsBitmask);
             }
-            fillComponentsRecord(record, std::forward<Components>(components)...);
-            const auto nextArchetype = getOrCreateArchetype(bitmask);
             if (!nextArchetype) {
                 return false;
             }
-            migrateEntity(entity, prevArchetype, nextArchetype, record);
-            if (prevArchetype != nullptr && prevArchetype != nextArchetype) {
+            SharedBuffer shared;
+            if (nextArchetype == prevArchetype) {
+                auto location = prev.location;
+                if constexpr ((kIsShared<Components> || ...)) {
+                    const auto relocated = nextArchetype->relocate(entity, location, sharedValues(*nextArchetype, prev, shared, components...));
+                    if (!relocated.has_value()) {
+                        return false;
+                    }
+                    location = relocated.value();
+                }
+                (write(nextArchetype, location, components), ...);
+                changeNotifier->notifyUpdate(nextArchetype);
+                return true;
+            }
+            const auto location = nextArchetype->emplace(entity, sharedValues(*nextArchetype, prev, shared, components...));
+            if (!location.has_value()) {
+                return false;
+            }
+            if (prevArchetype) {
+                // The target holds every column of the source, so the whole source row carries over.
+                nextArchetype->copyFrom(location.value(), *prevArchetype, prev.location, prevArchetype->getColumns());
+            }
+            (write(nextArchetype, location.value(), components), ...);
+            if (prevArchetype) {
+                prevArchetype->remove(entity, prev.location);
+                compactIfSparse(prevArchetype);
                 changeNotifier->notifyUpdate(prevArchetype);
             }
             changeNotifier->notifyUpdate(nextArchetype);
             return true;
         }
 
+        // Places entities that have no components yet into the archetype of exactly `Components`.
+        // `fill(first, n, columns...)` receives, for entities[first, first + n), a pointer to the first row of each column;
+        // tags have no column and get nullptr.
+        template<typename... Components, typename Fill>
+        size_t createBatch(const std::span<const Entity> entities, Fill &&fill) {
+            static_assert((!kIsShared<Components> && ...), "Batches can't group by shared values that init hasn't set yet; use instantiate");
+            static_assert((!kIsChunkComponent<Components> && ...), "Chunk components have no rows to fill; set them per chunk instead");
+            static_assert((!kIsSparse<Components> && ...), "Sparse components have no columns; set them after the batch is created");
+            const auto &componentsBitmask = SignatureID<Entity, Components...>::cached();
+            registerComponents<Components...>();
+            auto *archetype = getOrCreateArchetype(componentsBitmask);
+            if (!archetype || entities.empty()) {
+                return 0;
+            }
+            const auto placed = archetype->emplaceBatch(entities, [&](const Chunks::Chunk &chunk, const size_t row, const size_t first, const size_t n) {
+                fill(first, n, column<std::decay_t<Components> >(chunk, row)...);
+            });
+            if (placed > 0) {
+                changeNotifier->notifyUpdate(archetype);
+            }
+            return placed;
+        }
+
+        // Places `entities` into the prefab's archetype as copies of the prefab's row.
+        size_t instantiate(const Entity prefab, const std::span<const Entity> entities) {
+            const auto source = entitiesMap.get(prefab);
+            auto *archetype = source.archetype;
+            if (!archetype || entities.empty()) {
+                return 0;
+            }
+            // Column 0 holds the Entity ids, which emplaceBatch has already written.
+            const auto columns = archetype->getColumns().subspan(1);
+            SharedBuffer shared;
+            const auto placed = archetype->emplaceBatch(entities, [&](const Chunks::Chunk &chunk, const size_t row, size_t, const size_t n) {
+                Chunks::broadcast(chunk, row, n, (*archetype)[source.location.chunkIndex], source.location.indexInChunk, columns);
+            }, sharedValues(*archetype, source, shared));
+            std::vector<std::byte> value;
+            for (const auto type: sparseTypes) {
+                auto &set = *sparseSets[type];
+                if (!set.contains(prefab)) {
+                    continue;
+                }
+                // The set may grow while it is filled, so the prefab's value is copied out first.
+                const auto *prefabValue = static_cast<const std::byte *>(set.get(prefab));
+                value.assign(prefabValue, prefabValue + registry->getType(type).size);
+                for (size_t i = 0; i < placed; ++i) {
+                    set.set(entities[i], value.data());
+                }
+            }
+            if (placed > 0) {
+                changeNotifier->notifyUpdate(archetype);
+            }
+            return placed;
+        }
+
         template<typename Component>
         bool removeComponent(Entity entity) {
-            static const auto removed = ComponentTypeID::getTypeInfo<Component>();
-            auto prevArchetype = entitiesMap[entity].archetype;
+            static_assert(!std::is_same_v<std::decay_t<Component>, Entity>, "The Entity column can't be removed");
+            if constexpr (kIsSparse<Component>) {
+                const auto &set = sparseSets[ComponentTypeID::get<Component>()];
+                return set && set->erase(entity);
+            }
+            const auto removed = ComponentTypeID::getTypeInfo<Component>();
+            const auto prev = entitiesMap.get(entity);
+            auto *prevArchetype = prev.archetype;
             if (!prevArchetype) {
                 return false;
             }
-            auto bitmask = prevArchetype->getSignature();
-            if (!bitmask.test(removed.type)) {
+            if (!prevArchetype->getSignature().test(removed.type)) {
                 return false;
             }
-            bitmask.reset(removed.type);
-            if (bitmask.none()) {
-                prevArchetype->remove(entity);
-                changeNotifier->notifyUpdate(prevArchetype);
-                entitiesMap[entity].archetype = nullptr;
-                return true;
-            }
-            auto nextArchetype = getOrCreateArchetype(bitmask);
+            auto *nextArchetype = getOrCreateRemoveTarget(prevArchetype, removed.type);
             if (!nextArchetype) {
-                prevArchetype->remove(entity);
-                changeNotifier->notifyUpdate(prevArchetype);
-                entitiesMap[entity].archetype = nullptr;
                 return false;
             }
-            auto record = ComponentsRecord{};
-            record[0] = &entity;
-            if (!prevArchetype->fillComponentRecord(record)) {
+            SharedBuffer shared;
+            const auto location = nextArchetype->emplace(entity, sharedValues(*nextArchetype, prev, shared));
+            if (!location.has_value()) {
                 return false;
             }
-            migrateEntity(entity, prevArchetype, nextArchetype, record);
-            // entitiesMap[entity].archetype = nextArchetype;
-            // entitiesMap[entity].location = *nextArchetype->getEntityLocation(entity);
+            // Every column of the target exists in the source.
+            nextArchetype->copyFrom(location.value(), *prevArchetype, prev.location, nextArchetype->getColumns());
+            prevArchetype->remove(entity, prev.location);
+            compactIfSparse(prevArchetype);
             changeNotifier->notifyUpdate(prevArchetype);
             changeNotifier->notifyUpdate(nextArchetype);
             return true;
         }
 
+        // setComponents for a run of entities: the leading ones that share an archetype move to the target together, one
+        // memcpy per row instead of one emplace per entity. `get(i)` returns the components of entities[i] as a tuple.
+        // Returns how many leading entities were handled; the caller continues with the rest. 0 means entities[0] failed.
+        template<typename... Components, typename Get>
+        size_t setComponentsBatch(const std::span<const Entity> entities, Get &&get) {
+            static_assert(((!kIsShared<Components> && !kIsChunkComponent<Components> && !kIsSparse<Components>) && ...),
+                          "Only plain components are set in batches");
+            if (entities.empty()) {
+                return 0;
+            }
+            registerComponents<Components...>();
+            std::vector<BatchRow> rows;
+            auto *source = collectRows(entities, rows);
+            Archetype *target = source;
+            if (source) {
+                ((target = getOrCreateAddTarget(target, ComponentTypeID::get<Components>())), ...);
+            } else {
+                target = getOrCreateArchetype(SignatureID<Entity, Components...>::cached());
+            }
+            if (!canMoveRows(source, target, rows.size())) {
+                for (size_t i = 0; i < rows.size(); ++i) {
+                    const bool set = std::apply([&](auto &... values) { return setComponents(entities[i], std::move(values)...); }, get(i));
+                    if (!set) {
+                        return i;
+                    }
+                }
+                return rows.size();
+            }
+            return moveRows(source, target, entities, rows, [&](const Chunks::Chunk &chunk, const size_t row, const size_t first, const size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    std::apply([&](const auto &... values) { (writeRow(chunk, row + i, values), ...); }, get(first + i));
+                }
+            });
+        }
+
+        // removeComponent for a run of entities, moving the leading ones that share an archetype together.
+        // Entities without the component count as handled, as removeComponent leaves them alone.
+        template<typename Component>
+        size_t removeComponentBatch(const std::span<const Entity> entities) {
+            static_assert(!std::is_same_v<std::decay_t<Component>, Entity>, "The Entity column can't be removed");
+            static_assert(!kIsSparse<Component>, "Sparse components are removed from their set, not moved");
+            if (entities.empty()) {
+                return 0;
+            }
+            std::vector<BatchRow> rows;
+            auto *source = collectRows(entities, rows);
+            const auto type = ComponentTypeID::get<Component>();
+            if (!source || !source->getSignature().test(type)) {
+                return rows.size();
+            }
+            auto *target = getOrCreateRemoveTarget(source, type);
+            if (!canMoveRows(source, target, rows.size())) {
+                for (size_t i = 0; i < rows.size(); ++i) {
+                    removeComponent<Component>(entities[i]);
+                }
+                return rows.size();
+            }
+            return moveRows(source, target, entities, rows, [](const Chunks::Chunk &, size_t, size_t, size_t) {});
+        }
+
+        // Destroys every entity of every archetype matching the query; the destroyed ids are appended to `destroyed`.
+        size_t destroyAll(const Signature &including, const Signature &excluding, std::vector<Entity> &destroyed) {
+            const auto first = destroyed.size();
+            size_t total = 0;
+            for (const auto &[signature, archetype]: archetypes) {
+                if (archetype->size() == 0 || !matches(signature, including, excluding)) {
+                    continue;
+                }
+                total += archetype->clear(destroyed);
+                changeNotifier->notifyUpdate(archetype.get());
+            }
+            dropSparse(std::span(destroyed).subspan(first));
+            return total;
+        }
+
+        // Destroys the entities of matching archetypes for which `predicate(components&...)` returns true.
+        template<typename... Components, typename Predicate>
+        size_t destroyIf(const Signature &excluding, Predicate &&predicate, std::vector<Entity> &destroyed) {
+            static_assert((!kIsSparse<Components> && ...), "Predicates only see archetype columns");
+            const auto &including = SignatureID<Components...>::cached();
+            const auto first = destroyed.size();
+            size_t total = 0;
+            for (const auto &[signature, archetype]: archetypes) {
+                if (archetype->size() == 0 || !matches(signature, including, excluding)) {
+                    continue;
+                }
+                const auto removed = archetype->removeIf([&](const Chunks::Chunk &chunk, const Chunks::Index row) {
+                    return predicate(componentAt<Components>(chunk, row)...);
+                }, destroyed);
+                if (removed > 0) {
+                    compactIfSparse(archetype.get());
+                    changeNotifier->notifyUpdate(archetype.get());
+                    total += removed;
+                }
+            }
+            dropSparse(std::span(destroyed).subspan(first));
+            return total;
+        }
+
+        // Adds `value` to every entity matching the query, moving whole archetypes at once. Entities that already
+        // have the component get it overwritten; a chunk component is written into every chunk holding a matching entity.
+        // Returns the number of entities updated.
+        template<typename Component>
+        size_t addComponentToAll(const Signature &including, const Signature &excluding, const Component &value) {
+            registerComponents<Component>();
+            const auto type = ComponentTypeID::get<Component>();
+            size_t updated = 0;
+            if constexpr (kIsSparse<Component>) {
+                auto &set = sparseSet<Component>();
+                for (const auto &[signature, archetype]: archetypes) {
+                    if (archetype->size() == 0 || !matches(signature, including, excluding)) {
+                        continue;
+                    }
+                    for (const auto &chunk: archetype->getChunks()) {
+                        const auto *entities = reinterpret_cast<const Entity *>(chunk.components[0].ptr);
+                        for (size_t row = 0; row < chunk.size; ++row) {
+                            set.set(entities[row], kIsTag<Component> ? nullptr : &value);
+                        }
+                    }
+                    updated += archetype->size();
+                }
+                return updated;
+            }
+            std::vector<Archetype *> sources;
+            for (const auto &[signature, archetype]: archetypes) {
+                if (archetype->size() == 0 || !matches(signature, including, excluding)) {
+                    continue;
+                }
+                if (signature.test(type)) {
+                    if constexpr (kIsChunkComponent<Component>) {
+                        for (const auto &chunk: archetype->getChunks()) {
+                            writeChunk(chunk, value);
+                        }
+                    } else if constexpr (kIsShared<Component>) {
+                        archetype->setShared(type, &value);
+                    } else if constexpr (!kIsTag<Component>) {
+                        archetype->fillColumn(type, &value);
+                    }
+                    changeNotifier->notifyUpdate(archetype.get());
+                    updated += archetype->size();
+                } else {
+                    sources.push_back(archetype.get());
+                }
+            }
+            std::vector<Migration> migrations;
+            for (auto *source: sources) {
+                if (auto *target = getOrCreateAddTarget(source, type)) {
+                    migrations.push_back({source, target, source->getColumns()});
+                }
+            }
+            return updated + migrateAll(migrations, [type, &value](const Chunks::Chunk &chunk, const Chunks::Index row, const size_t n) {
+                if constexpr (kIsChunkComponent<Component>) {
+                    writeChunk(chunk, value);
+                } else if constexpr (!kIsTag<Component> && !kIsShared<Component>) {
+                    Chunks::fill(chunk, type, row, n, &value);
+                }
+            }, kIsShared<Component> ? &value : nullptr);
+        }
+
+        // Removes `Component` from every entity matching the query, moving whole archetypes at once.
+        template<typename Component>
+        size_t removeComponentFromAll(const Signature &including, const Signature &excluding) {
+            static_assert(!std::is_same_v<std::decay_t<Component>, Entity>, "The Entity column can't be removed");
+            const auto type = ComponentTypeID::get<Component>();
+            if constexpr (kIsSparse<Component>) {
+                auto *set = sparseSets[type].get();
+                size_t removed = 0;
+                // Erasing moves the last entity into the freed slot, so walking backwards visits everyone once.
+                for (size_t i = set ? set->count() : 0; i-- > 0;) {
+                    const auto entity = set->getEntities()[i];
+                    const auto *archetype = entitiesMap.get(entity).archetype;
+                    if (archetype && matches(archetype->getSignature(), including, excluding)) {
+                        removed += set->erase(entity);
+                    }
+                }
+                return removed;
+            }
+            std::vector<Archetype *> sources;
+            for (const auto &[signature, archetype]: archetypes) {
+                if (archetype->size() > 0 && signature.test(type) && matches(signature, including, excluding)) {
+                    sources.push_back(archetype.get());
+                }
+            }
+            std::vector<Migration> migrations;
+            for (auto *source: sources) {
+                if (auto *target = getOrCreateRemoveTarget(source, type)) {
+                    migrations.push_back({source, target, target->getColumns()});
+                }
+            }
+            return migrateAll(migrations, [](const Chunks::Chunk &, Chunks::Index, size_t) {});
+        }
+
         bool removeEntity(const Entity entity) noexcept {
-            const auto archetype = entitiesMap[entity].archetype;
+            const auto archetype = entitiesMap.get(entity).archetype;
 #ifndef NDEBUG
             assert(archetype != nullptr);
 #endif
@@ -171,14 +741,54 @@ namespace ECS {
                 return false;
             }
             archetype->remove(entity);
+            dropSparse({&entity, 1});
+            compactIfSparse(archetype);
             changeNotifier->notifyUpdate(archetype);
-            entitiesMap[entity].archetype = nullptr;
             return true;
         }
 
+        [[nodiscard]] double getFillFactor() const noexcept {
+            size_t entities = 0;
+            size_t capacity = 0;
+            for (const auto &[_, archetype]: archetypes) {
+                entities += archetype->size();
+                capacity += archetype->capacity();
+            }
+            return capacity == 0 ? 1.0 : static_cast<double>(entities) / capacity;
+        }
+
+        CompactionStats compact(const size_t maxMoves = std::numeric_limits<size_t>::max()) {
+            CompactionStats stats;
+            stats.fillFactorBefore = getFillFactor();
+            for (const auto &[_, archetype]: archetypes) {
+                if (stats.entitiesMoved >= maxMoves) {
+                    break;
+                }
+                const auto chunksBefore = archetype->chunkCount();
+                const auto moved = archetype->compact(maxMoves - stats.entitiesMoved);
+                if (moved > 0) {
+                    stats.entitiesMoved += moved;
+                    stats.chunksReleased += chunksBefore - archetype->chunkCount();
+                    changeNotifier->notifyUpdate(archetype.get());
+                }
+            }
+            stats.fillFactorAfter = getFillFactor();
+            return stats;
+        }
+
+        // Compacts an archetype by up to movesPerStep entities whenever a removal leaves it below minFillFactor.
+        void setCompactionPolicy(const double minFillFactor, const size_t movesPerStep) noexcept {
+            compactionFillFactor = minFillFactor;
+            compactionMovesPerStep = movesPerStep;
+        }
+
         template<typename Component>
         [[nodiscard]] bool hasComponent(const Entity entity) const noexcept {
-            const auto* archetype = entitiesMap[entity].archetype;
+            if constexpr (kIsSparse<Component>) {
+                const auto &set = sparseSets[ComponentTypeID::get<Component>()];
+                return set && set->contains(entity);
+            }
+            const auto* archetype = entitiesMap.get(entity).archetype;
             if (!archetype) {
                 return false;
             }
@@ -186,8 +796,49 @@ namespace ECS {
             return archetype->getSignature().test(type);
         }
 
+        // Switches an enableable component off or on in place; false when the entity doesn't have it.
+        template<typename Component>
+        bool setEnabled(const Entity entity, const bool enabled) noexcept {
+            static_assert(kIsEnableable<Component> && !kIsTag<Component> && !kIsShared<Component> && !kIsChunkComponent<Component> &&
+                          !kIsSparse<Component>, "Only per-row components declaring kEnableable can be disabled");
+            const auto &record = entitiesMap.get(entity);
+            const auto type = ComponentTypeID::get<Component>();
+            if (!record.archetype || !record.archetype->getSignature().test(type)) {
+                return false;
+            }
+            record.archetype->setEnabled(record.location, type, enabled);
+            return true;
+        }
+
+        // False when the entity doesn't have the component; components that can't be disabled are always enabled.
+        template<typename Component>
+        [[nodiscard]] bool isEnabled(const Entity entity) const noexcept {
+            if (!hasComponent<Component>(entity)) {
+                return false;
+            }
+            if constexpr (kIsEnableable<Component> && !kIsTag<Component> && !kIsSparse<Component>) {
+                const auto &record = entitiesMap.get(entity);
+                return record.archetype->isEnabled(record.location, ComponentTypeID::get<Component>());
+            }
+            return true;
+        }
+
+        // Overrides the component's kCold hint for archetypes created from now on.
+        template<typename Component>
+        void setCold(const bool cold = true) const noexcept {
+            registerComponents<Component>();
+            registry->setCold(ComponentTypeID::get<Component>(), cold);
+        }
+
+        [[nodiscard]] const Archetype *getArchetype(const Entity entity) const noexcept { return entitiesMap.get(entity).archetype; }
+        [[nodiscard]] const EntityRecord &getRecord(const Entity entity) const noexcept { return entitiesMap.get(entity); }
+
+        [[nodiscard]] bool isSparse(const ComponentType type) const noexcept { return registry->isSparse(type); }
+        // nullptr until an entity first gets a component of `type`.
+        [[nodiscard]] SparseSet *getSparseSet(const ComponentType type) const noexcept { return sparseSets[type].get(); }
+
         [[nodiscard]] const Signature& getSignature(const Entity entity) const noexcept {
-            const auto* archetype = entitiesMap[entity].archetype;
+            const auto* archetype = entitiesMap.get(entity).archetype;
             if (!archetype) {
                 return kEmptySignature;
             }
@@ -196,30 +847,40 @@ namespace ECS {
 
         template<typename Component>
         [[nodiscard]] inline Component *getComponent(const Entity entity) const noexcept {
-            static const auto typeId = ComponentTypeID::get<Component>();
-            const auto& location = entitiesMap[entity];
+            if constexpr (kIsSparse<Component>) {
+                auto *set = sparseSets[ComponentTypeID::get<Component>()].get();
+                if (!set || !set->contains(entity)) {
+                    return nullptr;
+                }
+                if constexpr (kIsTag<Component>) {
+                    return &tagInstance<Component>;
+                }
+                return static_cast<Component *>(set->get(entity));
+            }
+            const auto typeId = ComponentTypeID::get<Component>();
+            const auto& location = entitiesMap.get(entity);
             const auto* archetype = location.archetype;
-#ifndef NDEBUG
-            assert(archetype != nullptr);
-#endif
             if (!archetype) {
                 [[unlikely]] return nullptr;
             }
             if (!archetype->getSignature().test(typeId)) {
                 [[unlikely]] return nullptr;
             }
+            if constexpr (kIsTag<Component>) {
+                return &tagInstance<Component>;
+            }
             return reinterpret_cast<Component *>(archetype->getComponentByLocation(location.location, typeId));
         }
 
         inline bool fillComponentRecord(Entity entity, std::span<void *> record) const {
-            const auto& location = entitiesMap[entity];
+            const auto& location = entitiesMap.get(entity);
             record[0] = &entity;
             return location.archetype->fillComponentRecordByLocation(record, location.location);
         }
 
         template<size_t N>
         inline bool fillComponentsInRecord(Entity entity, std::span<void *> record, const std::array<const ComponentType, N> components) const {
-            const auto& location = entitiesMap[entity];
+            const auto& location = entitiesMap.get(entity);
             record[0] = &entity;
             return location.archetype->fillComponentRecordByTypesByLocation<N>(record, location.location, components);
         }
@@ -10,6 +10,7 @@
 #include <algorithm>
 #include <future>
 #include <memory>
+#include <unordered_set>
 #include "Archetype.hpp"
 
 namespace ECS {
@@ -51,6 +52,19 @@ namespace ECS {
             }
         }
 
+        // Between beginBatch() and the matching endBatch() notifications are collected and then delivered once per archetype.
+        void beginBatch() { ++batchDepth; }
+
+        void endBatch() {
+            if (batchDepth == 0 || --batchDepth > 0) {
+                return;
+            }
+            deliver(pendingAdds, addEventSubscribers);
+            deliver(pendingUpdates, updateEventSubscribers);
+        }
+
+        [[nodiscard]] bool isBatching() const { return batchDepth > 0; }
+
     private:
         struct CallbackEntry {
             CallbackId id;
@@ -61,7 +75,38 @@ namespace ECS {
         std::vector<CallbackEntry> updateEventSubscribers;
         CallbackId nextId = 0;
 
-        void notifyAdd(const Archetype *archetype) const {
+        size_t batchDepth = 0;
+        std::vector<const Archetype *> pendingAdds;
+        std::vector<const Archetype *> pendingUpdates;
+
+        // Migrations notify their source and target in turn, so looking at the last few entries drops most repeats.
+        static void collect(std::vector<const Archetype *> &pending, const Archetype *archetype) {
+            const auto recent = std::min<size_t>(pending.size(), 8);
+            if (std::find(pending.end() - static_cast<std::ptrdiff_t>(recent), pending.end(), archetype) == pending.end()) {
+                pending.push_back(archetype);
+            }
+        }
+
+        // Archetypes are delivered in the order they were first seen, so views don't depend on heap addresses.
+        static void deliver(std::vector<const Archetype *> &pending, const std::vector<CallbackEntry> &subscribers) {
+            std::unordered_set<const Archetype *> delivered;
+            delivered.reserve(pending.size());
+            for (const auto *archetype: pending) {
+                if (!delivered.insert(archetype).second) {
+                    continue;
+                }
+                for (const auto &subscriber: subscribers) {
+                    subscriber.callback(archetype);
+                }
+            }
+            pending.clear();
+        }
+
+        void notifyAdd(const Archetype *archetype) {
+            if (batchDepth > 0) {
+                collect(pendingAdds, archetype);
+                return;
+            }
             // std::thread([this, archetype] {
                 for (const auto &subscriber: addEventSubscribers) {
                     subscriber.callback(archetype);
@@ -69,7 +114,11 @@ namespace ECS {
             // }).detach();
         }
 
-        void notifyUpdate(const Archetype *archetype) const {
+        void notifyUpdate(const Archetype *archetype) {
+            if (batchDepth > 0) {
+                collect(pendingUpdates, archetype);
+                return;
+            }
             // std::thread([this, archetype] {
                 for (const auto &subscriber: updateEventSubscribers) {
                     subscriber.callback(archetype);
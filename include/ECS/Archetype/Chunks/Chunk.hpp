@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <bit>
 #include <span>
 #include <array>
 #include <cstring>
@@ -22,27 +24,71 @@ namespace ECS::Chunks {
     struct ComponentData {
         char * ptr;
         uint16_t stride;
+        // Offset of the column's enable bitmask from the start of the chunk, one bit per row; 0 when the component
+        // can't be disabled. Masks sit after the columns, so no mask ever starts at 0.
+        uint32_t enabled;
     };
 
     struct Chunk {
-        const std::array<ComponentData, MAX_COMPONENTS> components;
+        std::array<ComponentData, MAX_COMPONENTS> components;
         size_t size;
-        const Index capacity;
-        const Signature signature;
+        Index capacity;
+        // Components with one value per row; tags, shared and chunk components are left out.
+        Signature signature;
+        char *memory;
+        // Holds the cold columns; nullptr when the archetype has none.
+        char *companion = nullptr;
     };
 
+    static constexpr size_t kMaskWordBits = 64;
+
+    [[nodiscard]] inline uint64_t *enabledMask(const Chunk &chunk, const ComponentIndex componentIndex) noexcept {
+        const auto offset = chunk.components[componentIndex].enabled;
+        return offset ? reinterpret_cast<uint64_t *>(chunk.memory + offset) : nullptr;
+    }
+
+    [[nodiscard]] inline bool testBit(const uint64_t *mask, const Index index) noexcept {
+        return (mask[index / kMaskWordBits] >> (index % kMaskWordBits)) & 1;
+    }
+
+    inline void setBit(uint64_t *mask, const Index index, const bool value) noexcept {
+        const uint64_t bit = uint64_t{1} << (index % kMaskWordBits);
+        auto &word = mask[index / kMaskWordBits];
+        word = value ? word | bit : word & ~bit;
+    }
+
+    // Sets bits [index, index + count) a word at a time.
+    inline void setBits(uint64_t *mask, const Index index, const Index count, const bool value) noexcept {
+        for (Index bit = index, end = index + count; bit < end;) {
+            const auto offset = bit % kMaskWordBits;
+            const auto n = std::min<Index>(kMaskWordBits - offset, end - bit);
+            const uint64_t bits = (n == kMaskWordBits ? ~uint64_t{0} : (uint64_t{1} << n) - 1) << offset;
+            auto &word = mask[bit / kMaskWordBits];
+            word = value ? word | bits : word & ~bits;
+            bit += n;
+        }
+    }
+
+    inline void copyBits(uint64_t *destination, const Index destinationIndex, const uint64_t *source, const Index sourceIndex,
+                         const Index count) noexcept {
+        for (Index i = 0; i < count; ++i) {
+            setBit(destination, destinationIndex + i, testBit(source, sourceIndex + i));
+        }
+    }
+
     static bool set(const Chunk &chunk, std::span<void *> data, Index index) {
         if (index >= chunk.capacity) {
             return false;
         }
-        for (auto i = chunk.signature.lowestBit; i <= chunk.signature.highestBit; i++) {
-            if (chunk.signature[i]) {
-                auto& component = chunk.components[i];
-                void *dst = component.ptr + index * component.stride;
-                const void *src = data[i];
-                std::memcpy(dst, src, component.stride);
+        chunk.signature.forEachSetBit([&](const ComponentIndex i) {
+            auto& component = chunk.components[i];
+            void *dst = component.ptr + index * component.stride;
+            const void *src = data[i];
+            std::memcpy(dst, src, component.stride);
+            if (component.enabled) {
+                setBit(enabledMask(chunk, i), index, true);
             }
-        }
+        });
         return true;
     }
 
@@ -55,15 +101,84 @@ namespace ECS::Chunks {
         if (source == destination)
             return;
 
-        for (auto i = chunk.signature.lowestBit; i <= chunk.signature.highestBit; i++) {
-            if (chunk.signature[i]) {
-                const auto &component = chunk.components[i];
-                void *ptrA = component.ptr + source * component.stride;
-                void *ptrB = component.ptr + destination * component.stride;
-                uint8_t temp[kBufferSize];
-                std::memcpy(temp, ptrA, component.stride);
-                std::memcpy(ptrA, ptrB, component.stride);
-                std::memcpy(ptrB, temp, component.stride);
+        chunk.signature.forEachSetBit([&](const ComponentIndex i) {
+            const auto &component = chunk.components[i];
+            void *ptrA = component.ptr + source * component.stride;
+            void *ptrB = component.ptr + destination * component.stride;
+            uint8_t temp[kBufferSize];
+            std::memcpy(temp, ptrA, component.stride);
+            std::memcpy(ptrA, ptrB, component.stride);
+            std::memcpy(ptrB, temp, component.stride);
+            if (component.enabled) {
+                auto *mask = enabledMask(chunk, i);
+                const bool enabled = testBit(mask, source);
+                setBit(mask, source, testBit(mask, destination));
+                setBit(mask, destination, enabled);
+            }
+        });
+    }
+
+    inline void copy(const Chunk &destination, Index destinationIndex, const Chunk &source, Index sourceIndex) {
+        source.signature.forEachSetBit([&](const ComponentIndex i) {
+            const auto &from = source.components[i];
+            const auto &to = destination.components[i];
+            std::memcpy(to.ptr + destinationIndex * to.stride, from.ptr + sourceIndex * from.stride, from.stride);
+            if (from.enabled) {
+                setBit(enabledMask(destination, i), destinationIndex, testBit(enabledMask(source, i), sourceIndex));
+            }
+        });
+    }
+
+    // Copies only the listed columns; both chunks must contain all of them.
+    inline void copy(const Chunk &destination, Index destinationIndex, const Chunk &source, Index sourceIndex,
+                     std::span<const ComponentIndex> columns) {
+        for (const auto i: columns) {
+            const auto &from = source.components[i];
+            const auto &to = destination.components[i];
+            std::memcpy(to.ptr + destinationIndex * to.stride, from.ptr + sourceIndex * from.stride, from.stride);
+            if (from.enabled) {
+                setBit(enabledMask(destination, i), destinationIndex, testBit(enabledMask(source, i), sourceIndex));
+            }
+        }
+    }
+
+    // Copies rows [sourceIndex, sourceIndex + count) of the listed columns with one memcpy per column.
+    inline void copy(const Chunk &destination, Index destinationIndex, const Chunk &source, Index sourceIndex, Index count,
+                     std::span<const ComponentIndex> columns) {
+        for (const auto i: columns) {
+            const auto &from = source.components[i];
+            const auto &to = destination.components[i];
+            std::memcpy(to.ptr + destinationIndex * to.stride, from.ptr + sourceIndex * from.stride, count * from.stride);
+            if (from.enabled) {
+                copyBits(enabledMask(destination, i), destinationIndex, enabledMask(source, i), sourceIndex, count);
+            }
+        }
+    }
+
+    // Writes `value` into rows [index, index + count) of one column, doubling the copied run on every pass.
+    inline void fill(const Chunk &chunk, ComponentIndex componentIndex, Index index, Index count, const void *value) {
+        if (count == 0) {
+            return;
+        }
+        const auto &component = chunk.components[componentIndex];
+        const size_t stride = component.stride;
+        char *first = component.ptr + index * stride;
+        std::memcpy(first, value, stride);
+        for (Index filled = 1; filled < count;) {
+            const Index run = std::min(filled, count - filled);
+            std::memcpy(first + filled * stride, first, run * stride);
+            filled += run;
+        }
+    }
+
+    // Replicates row `sourceIndex` of `source` into rows [destinationIndex, destinationIndex + count) of `destination`.
+    inline void broadcast(const Chunk &destination, Index destinationIndex, Index count, const Chunk &source, Index sourceIndex,
+                          std::span<const ComponentIndex> columns) {
+        for (const auto i: columns) {
+            const auto &from = source.components[i];
+            fill(destination, i, destinationIndex, count, from.ptr + sourceIndex * from.stride);
+            if (from.enabled) {
+                setBits(enabledMask(destination, i), destinationIndex, count, testBit(enabledMask(source, i), sourceIndex));
             }
         }
     }
@@ -0,0 +1,244 @@
+//
+//  ChunkArena.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <ECS/Entity.h>
+#include "Chunk.hpp"
+
+namespace ECS::Chunks {
+
+    enum class PageKind : uint8_t {
+        Regular,
+        Transparent,
+        HugeTLB
+    };
+
+    class ChunkArena final {
+        static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+        char *basePtr = nullptr;
+        const size_t chunkSize;
+        const size_t chunkCount;
+        const size_t pageSize;
+        size_t commitGranularity;
+        size_t reserved = 0;
+        size_t committed = 0;
+        // Committed bytes whose pages were handed back by discard() and not touched since.
+        size_t discarded = 0;
+        std::vector<bool> discardedChunks;
+        // Commit steps of a HugeTLB arena that got explicit huge pages rather than the regular page fallback.
+        std::vector<bool> hugeSteps;
+        size_t hugeCommitted = 0;
+        size_t hugeDiscarded = 0;
+        PageKind pageKind = PageKind::Regular;
+
+        [[nodiscard]] static size_t alignTo(const size_t bytes, const size_t alignment) noexcept {
+            return (bytes + alignment - 1) & ~(alignment - 1);
+        }
+
+        [[nodiscard]] size_t discardGranularity() const noexcept {
+            return pageKind == PageKind::HugeTLB ? kHugePageSize : pageSize;
+        }
+
+        // The whole pages inside the chunk at `offset`, which are the ones discard() can drop.
+        [[nodiscard]] std::pair<size_t, size_t> discardRange(const size_t offset) const noexcept {
+            const auto granularity = discardGranularity();
+            return {alignTo(offset, granularity), (offset + chunkSize) & ~(granularity - 1)};
+        }
+
+        bool reserveRegular(const size_t bytes) noexcept {
+            void *ptr = mmap(nullptr, bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (ptr == MAP_FAILED) {
+                return false;
+            }
+            basePtr = static_cast<char *>(ptr);
+            reserved = bytes;
+            return true;
+        }
+
+        // Reserves `bytes` of address space on a 2 MB boundary, so huge pages can back it in whole 2 MB steps.
+        [[nodiscard]] static char *reserveAligned(const size_t bytes) noexcept {
+            void *ptr = mmap(nullptr, bytes + kHugePageSize, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (ptr == MAP_FAILED) {
+                return nullptr;
+            }
+            auto *raw = static_cast<char *>(ptr);
+            auto *aligned = reinterpret_cast<char *>(alignTo(reinterpret_cast<uintptr_t>(raw), kHugePageSize));
+            if (aligned != raw) {
+                munmap(raw, aligned - raw);
+            }
+            munmap(aligned + bytes, raw + kHugePageSize - aligned);
+            return aligned;
+        }
+
+        // Transparent huge pages need a 2 MB aligned base and commits in whole 2 MB steps,
+        // otherwise the kernel can't back the committed prefix with huge pages.
+        bool reserveTransparent(const size_t bytes) noexcept {
+#ifdef MADV_HUGEPAGE
+            char *aligned = reserveAligned(bytes);
+            if (!aligned) {
+                return false;
+            }
+            if (madvise(aligned, bytes, MADV_HUGEPAGE) != 0) {
+                munmap(aligned, bytes);
+                return false;
+            }
+            basePtr = aligned;
+            reserved = bytes;
+            commitGranularity = kHugePageSize;
+            pageKind = PageKind::Transparent;
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Used when transparent huge pages are unavailable. Like the other kinds, the arena is only reserved here;
+        // commit() maps explicit huge pages over it one 2 MB step at a time.
+        bool reserveHugeTLB(const size_t bytes) noexcept {
+#ifdef MAP_HUGETLB
+            char *aligned = reserveAligned(bytes);
+            if (!aligned) {
+                return false;
+            }
+            basePtr = aligned;
+            reserved = bytes;
+            commitGranularity = kHugePageSize;
+            pageKind = PageKind::HugeTLB;
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Makes [ptr, ptr + bytes) read-write. Explicit huge pages are mapped over the reservation one step at a time,
+        // falling back to regular pages for a step when the kernel's huge page pool is exhausted.
+        bool commitRange(char *ptr, const size_t bytes) noexcept {
+#ifdef MAP_HUGETLB
+            if (pageKind == PageKind::HugeTLB) {
+                constexpr int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED;
+                for (size_t step = 0; step < bytes; step += kHugePageSize) {
+                    if (mmap(ptr + step, kHugePageSize, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0) != MAP_FAILED) {
+                        hugeSteps[(ptr + step - basePtr) / kHugePageSize] = true;
+                        hugeCommitted += kHugePageSize;
+                    } else if (mmap(ptr + step, kHugePageSize, PROT_READ | PROT_WRITE, flags, -1, 0) == MAP_FAILED) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+#endif
+            return mprotect(ptr, bytes, PROT_READ | PROT_WRITE) == 0;
+        }
+
+        [[nodiscard]] size_t hugeBytesIn(const size_t begin, const size_t end) const noexcept {
+            size_t bytes = 0;
+            for (size_t offset = begin; pageKind == PageKind::HugeTLB && offset < end; offset += kHugePageSize) {
+                bytes += hugeSteps[offset / kHugePageSize] ? kHugePageSize : 0;
+            }
+            return bytes;
+        }
+
+    public:
+        ChunkArena(const size_t chunkSize, const size_t chunkCount, const bool hugePages = CHUNK_HUGE_PAGES)
+            : ChunkArena(chunkSize, chunkCount, hugePages ? PageKind::Transparent : PageKind::Regular) {
+        }
+
+        // Transparent falls back to HugeTLB; every kind falls back to regular pages.
+        ChunkArena(const size_t chunkSize, const size_t chunkCount, const PageKind preferred)
+            : chunkSize(chunkSize), chunkCount(chunkCount), pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))),
+              commitGranularity(pageSize), discardedChunks(chunkCount) {
+            if (preferred != PageKind::Regular) {
+                const size_t bytes = alignTo(chunkSize * chunkCount, kHugePageSize);
+                if ((preferred == PageKind::Transparent && reserveTransparent(bytes)) || reserveHugeTLB(bytes)) {
+                    hugeSteps.resize(pageKind == PageKind::HugeTLB ? bytes / kHugePageSize : 0);
+                    return;
+                }
+            }
+            if (!reserveRegular(alignTo(chunkSize * chunkCount, pageSize))) {
+#ifndef NDEBUG
+                throw std::bad_alloc();
+#endif
+            }
+        }
+
+        ChunkArena(const ChunkArena &) = delete;
+        ChunkArena &operator=(const ChunkArena &) = delete;
+
+        ~ChunkArena() {
+            if (basePtr) {
+                munmap(basePtr, reserved);
+            }
+        }
+
+        [[nodiscard]] size_t getChunkSize() const noexcept { return chunkSize; }
+        [[nodiscard]] size_t getChunkCount() const noexcept { return chunkCount; }
+        [[nodiscard]] PageKind getPageKind() const noexcept { return pageKind; }
+        [[nodiscard]] size_t reservedBytes() const noexcept { return reserved; }
+        // Bytes backed by memory: the committed prefix minus the chunks trimmed since.
+        [[nodiscard]] size_t committedBytes() const noexcept { return committed - discarded; }
+        // Committed bytes backed by explicit huge pages. Transparent huge pages are left to the kernel, which may or
+        // may not use them, so they are not counted.
+        [[nodiscard]] size_t hugePageBytes() const noexcept { return hugeCommitted - hugeDiscarded; }
+
+        // Makes the pages backing chunk `index` accessible. Commits only grow the accessible prefix,
+        // so the arena stays a single read-write mapping followed by the untouched reservation.
+        char *commit(const Index index) noexcept {
+            if (!basePtr || index >= chunkCount) {
+                return nullptr;
+            }
+            const size_t end = std::min(alignTo((index + 1) * chunkSize, commitGranularity), reserved);
+            if (end > committed) {
+                if (!commitRange(basePtr + committed, end - committed)) {
+                    return nullptr;
+                }
+                committed = end;
+            }
+            return basePtr + index * chunkSize;
+        }
+
+        [[nodiscard]] bool contains(const char *chunk) const noexcept {
+            return basePtr && chunk >= basePtr && chunk < basePtr + reserved;
+        }
+
+        // Drops the physical pages fully covered by the chunk; the range stays accessible and reads back as zeroes.
+        size_t discard(char *chunk) noexcept {
+            const auto offset = static_cast<size_t>(chunk - basePtr);
+            const auto index = offset / chunkSize;
+            const auto [begin, end] = discardRange(offset);
+            if (discardedChunks[index] || end <= begin || end > committed) {
+                return 0;
+            }
+            if (madvise(basePtr + begin, end - begin, MADV_DONTNEED) != 0) {
+                return 0;
+            }
+            discardedChunks[index] = true;
+            discarded += end - begin;
+            hugeDiscarded += hugeBytesIn(begin, end);
+            return end - begin;
+        }
+
+        // Called when a chunk is handed out again: its discarded pages come back as soon as it is written.
+        void reuse(const char *chunk) noexcept {
+            const auto offset = static_cast<size_t>(chunk - basePtr);
+            const auto index = offset / chunkSize;
+            if (!discardedChunks[index]) {
+                return;
+            }
+            const auto [begin, end] = discardRange(offset);
+            discardedChunks[index] = false;
+            discarded -= end - begin;
+            hugeDiscarded -= hugeBytesIn(begin, end);
+        }
+    };
+}
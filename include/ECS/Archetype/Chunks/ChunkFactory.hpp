@@ -10,6 +10,7 @@
 #include <optional>
 #include <ECS/Component/ComponentTypeInfo.hpp>
 #include "Chunk.hpp"
+#include "ChunkPool.hpp"
 #include "ECS/Archetype/ComponentRegistry.hpp"
 
 namespace ECS {
@@ -23,73 +24,124 @@ class ChunkFactory final {
     };
 
     const Signature bitset;
+    // The components of `bitset` that have a column; tags, shared and chunk components are left out.
+    Signature storage;
+    // Shared and chunk components, each stored once at the start of the chunk.
+    Signature shared;
+    Signature perChunk;
+    // Columns that carry an enable bitmask.
+    Signature enableable;
+    // Columns kept in the companion block; the chunk's masks stay in the chunk itself.
+    Signature cold;
     const std::shared_ptr<ComponentRegistry> registry;
     const Chunks::Index chunkSize;
     std::array<ChunkComponentLayout, MAX_COMPONENTS> chunkLayout;
+    std::array<uint32_t, MAX_COMPONENTS> maskOffsets{};
     Chunks::Index chunkCapacity = 0;
 
-    char *basePtr = nullptr;
-    Chunks::Index chunkCount = 0;
-    Chunks::Index chunkCreated = 0;
+    const std::shared_ptr<Chunks::ChunkPool> pool;
+    const Chunks::Index chunkCount;
+    Chunks::Index chunksInUse = 0;
     
     friend class ArchetypeFactory;
 
-    [[nodiscard]] std::array<Chunks::ComponentData, MAX_COMPONENTS> makeComponents() const {
+    [[nodiscard]] std::array<Chunks::ComponentData, MAX_COMPONENTS> makeComponents(char *chunkPtr, char *companionPtr) const {
         std::array<Chunks::ComponentData, MAX_COMPONENTS> components{};
-        const auto chunkPtr = basePtr + chunkCreated * CHUNK_SIZE;
-        for (auto i = bitset.lowestBit; i <= bitset.highestBit; i++) {
-            if (bitset[i]) {
-                const auto& layout = chunkLayout[i];
-                components[i] = {chunkPtr + layout.offset, layout.size};
-            }
-        }
+        storage.forEachSetBit([&](const ComponentType i) {
+            const auto& layout = chunkLayout[i];
+            components[i] = {(cold[i] ? companionPtr : chunkPtr) + layout.offset, layout.size, maskOffsets[i]};
+        });
+        // A zero stride makes every row of the column read the chunk's single value.
+        shared.forEachSetBit([&](const ComponentType i) { components[i] = {chunkPtr + chunkLayout[i].offset, 0, 0}; });
+        perChunk.forEachSetBit([&](const ComponentType i) {
+            components[i] = {chunkPtr + chunkLayout[i].offset, 0, 0};
+            std::memcpy(components[i].ptr, registry->getType(i).initial, chunkLayout[i].size);
+        });
         return components;
     }
 
   public:
     
     explicit ChunkFactory(const Signature& bitset, const std::shared_ptr<ComponentRegistry>& registry, const size_t chunkSize, const size_t reserveChunks)
-        : bitset(bitset), registry(registry), chunkSize(chunkSize), chunkCount(reserveChunks) {
-        basePtr = reinterpret_cast<char *>(std::malloc(reserveChunks * chunkSize));
-#ifndef NDEBUG
-        if (!basePtr) {
-            throw std::bad_alloc();
-        }
-#endif
+        : ChunkFactory(bitset, registry, std::make_shared<Chunks::ChunkPool>(chunkSize, reserveChunks), reserveChunks) {
+    }
 
+    explicit ChunkFactory(const Signature& bitset, const std::shared_ptr<ComponentRegistry>& registry, const std::shared_ptr<Chunks::ChunkPool>& pool, const size_t maxChunks)
+        : bitset(bitset), registry(registry), chunkSize(pool->getChunkSize()), pool(pool), chunkCount(maxChunks) {
         size_t entitySize = 0;
-        for (auto i = bitset.lowestBit; i <= bitset.highestBit; i++) {
+        size_t coldSize = 0;
+        size_t sharedSize = 0;
+        std::array<ChunkComponentLayout, MAX_COMPONENTS> layouts{};
+        bitset.forEachSetBit([&](const ComponentType i) {
+#ifndef NDEBUG
+            if (!registry->isRegistered(i)) {
+                throw std::runtime_error("Invalid component type");
+            }
+#endif
             const auto type = registry->getType(i);
-            if (bitset[i]) {
-                entitySize += type.size;
+            if (type.size == 0) {
+                return;
+            }
+            if (!type.shared && !type.chunk) {
+                storage.set(i);
+                if (type.cold) {
+                    cold.set(i);
+                    coldSize += type.size;
+                } else {
+                    entitySize += type.size;
+                }
+                if (type.enableable) {
+                    enableable.set(i);
+                }
+                return;
             }
+            (type.shared ? shared : perChunk).set(i);
+            sharedSize = (sharedSize + type.alignment - 1) & ~(type.alignment - 1);
+            layouts[i] = {sharedSize, type.size, type.alignment};
+            sharedSize += type.size;
+        });
+        // Each enableable column costs one more bit per row. Cold columns fill the companion block, which has the same
+        // number of rows, so the chunk holds as many rows as the fuller of the two allows.
+        const size_t rowBits = entitySize * 8 + enableable.count();
+        size_t capacity = sharedSize >= chunkSize ? 0 : rowBits > 0 ? (chunkSize - sharedSize) * 8 / rowBits : chunkSize;
+        if (coldSize > 0) {
+            capacity = std::min(capacity, chunkSize / coldSize);
         }
-        size_t capacity = chunkSize / entitySize;
-        std::array<ChunkComponentLayout, MAX_COMPONENTS> layouts{};
+        std::array<uint32_t, MAX_COMPONENTS> masks{};
         while (capacity > 0) {
-            size_t offset = 0;
+            size_t offset = sharedSize;
+            size_t coldOffset = 0;
             bool fits = true;
-            for (auto i = bitset.lowestBit; i <= bitset.highestBit; i++) {
-                if (bitset[i]) {
-                    auto& layout = layouts[i];
-                    const auto type = registry->getType(i);
-                    if (type.size == 0 || type.alignment == 0 || (type.alignment & (type.alignment - 1)) != 0) {
+            storage.forEachSetBit([&](const ComponentType i) {
+                if (!fits) {
+                    return;
+                }
+                auto& layout = layouts[i];
+                const auto type = registry->getType(i);
+                if (type.alignment == 0 || (type.alignment & (type.alignment - 1)) != 0) {
 #ifndef NDEBUG
-                        throw std::runtime_error("Invalid component type");
+                    throw std::runtime_error("Invalid component type");
 #endif
-                    }
-                    offset = (offset + type.alignment - 1) & ~(type.alignment - 1);
-                    layout.offset = offset;
-                    layout.size = type.size;
-                    layout.alignment = type.alignment;
-                    const size_t end = offset + type.size * capacity;
-                    if (end > chunkSize) {
-                        fits = false;
-                        break;
-                    }
-                    offset = end;
                 }
-            }
+                auto &blockOffset = cold[i] ? coldOffset : offset;
+                blockOffset = (blockOffset + type.alignment - 1) & ~(type.alignment - 1);
+                layout.offset = blockOffset;
+                layout.size = type.size;
+                layout.alignment = type.alignment;
+                const size_t end = blockOffset + type.size * capacity;
+                if (end > chunkSize) {
+                    fits = false;
+                    return;
+                }
+                blockOffset = end;
+            });
+            const size_t maskBytes = (capacity + Chunks::kMaskWordBits - 1) / Chunks::kMaskWordBits * sizeof(uint64_t);
+            offset = (offset + alignof(uint64_t) - 1) & ~(alignof(uint64_t) - 1);
+            enableable.forEachSetBit([&](const ComponentType i) {
+                masks[i] = static_cast<uint32_t>(offset);
+                offset += maskBytes;
+            });
+            fits = fits && offset <= chunkSize;
             if (fits)
                 break;
 #ifndef NDEBUG
@@ -99,23 +151,50 @@ class ChunkFactory final {
         }
         chunkCapacity = capacity;
         chunkLayout = layouts;
+        maskOffsets = masks;
     }
     
-    ~ChunkFactory() { std::free(basePtr); }
-
     [[nodiscard]] size_t getChunkCapacity() const { return chunkCapacity; }
+    [[nodiscard]] const Signature &getStorageSignature() const { return storage; }
+    [[nodiscard]] const Signature &getSharedSignature() const { return shared; }
+    [[nodiscard]] const Signature &getChunkSignature() const { return perChunk; }
+    [[nodiscard]] const Signature &getEnableableSignature() const { return enableable; }
+    [[nodiscard]] const Signature &getColdSignature() const { return cold; }
+    // Pool blocks each chunk takes: the chunk itself, plus its companion when there are cold columns.
+    [[nodiscard]] size_t getBlocksPerChunk() const { return cold.none() ? 1 : 2; }
     [[nodiscard]] size_t getChunkCount() const { return chunkCount; }
-    [[nodiscard]] bool canCreateChunk() const { return chunkCreated < chunkCount; }
+    [[nodiscard]] size_t getChunksInUse() const { return chunksInUse; }
+    [[nodiscard]] size_t reservedBytes() const { return pool->getStats().reservedBytes; }
+    [[nodiscard]] size_t committedBytes() const { return pool->getStats().committedBytes; }
+    [[nodiscard]] const std::shared_ptr<Chunks::ChunkPool> &getPool() const { return pool; }
+    [[nodiscard]] bool canCreateChunk() const { return chunksInUse < chunkCount && pool->canAcquire(getBlocksPerChunk()); }
 
     std::optional<Chunks::Chunk> create() {
-        if (!canCreateChunk()) {
-            std::cout << "canCreateChunk() == false as chunkCreated " << chunkCreated << " < chunkCount " << chunkCount << std::endl;
+        if (chunksInUse >= chunkCount) {
             return std::nullopt;
         }
-        Chunks::Chunk chunk{makeComponents(), 0, chunkCapacity, bitset};
-        ++chunkCreated;
+        const auto chunkPtr = pool->acquire();
+        if (!chunkPtr) {
+            return std::nullopt;
+        }
+        char *companionPtr = nullptr;
+        if (!cold.none()) {
+            companionPtr = pool->acquire();
+            if (!companionPtr) {
+                pool->release(chunkPtr);
+                return std::nullopt;
+            }
+        }
+        Chunks::Chunk chunk{makeComponents(chunkPtr, companionPtr), 0, chunkCapacity, storage, chunkPtr, companionPtr};
+        ++chunksInUse;
         return chunk;
     }
+
+    void release(const Chunks::Chunk &chunk) {
+        pool->release(chunk.memory);
+        pool->release(chunk.companion);
+        --chunksInUse;
+    }
 };
 
 }
@@ -0,0 +1,149 @@
+//
+//  ChunkPool.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "ChunkArena.hpp"
+
+namespace ECS::Chunks {
+
+    struct ChunkPoolStats {
+        size_t chunkSize = 0;
+        size_t reservedBytes = 0;
+        size_t committedBytes = 0;
+        size_t hugePageBytes = 0;
+        size_t chunksInUse = 0;
+        size_t chunksFree = 0;
+        size_t peakChunksInUse = 0;
+        size_t budgetBytes = 0;
+        size_t failedAcquires = 0;
+    };
+
+    class ChunkPool final {
+        const size_t chunkSize;
+        const size_t chunksPerArena;
+        const bool hugePages;
+
+        std::vector<std::unique_ptr<ChunkArena> > arenas;
+        Index arenaCursor = 0;
+        std::vector<char *> freeChunks;
+
+        size_t chunksInUse = 0;
+        size_t peakChunksInUse = 0;
+        size_t failedAcquires = 0;
+        size_t budget = std::numeric_limits<size_t>::max();
+
+        // Bulk migrations fill several archetypes from worker threads at once.
+        mutable std::mutex mutex;
+
+        char *acquireFromArena() noexcept {
+            if (arenas.empty() || arenaCursor == chunksPerArena) {
+                auto arena = std::make_unique<ChunkArena>(chunkSize, chunksPerArena, hugePages);
+                if (arena->reservedBytes() == 0) {
+                    return nullptr;
+                }
+                arenas.push_back(std::move(arena));
+                arenaCursor = 0;
+            }
+            char *chunk = arenas.back()->commit(arenaCursor);
+            if (chunk) {
+                ++arenaCursor;
+            }
+            return chunk;
+        }
+
+        // Every chunk handed out came from one of the arenas.
+        [[nodiscard]] ChunkArena &arenaOf(const char *chunk) const noexcept {
+            for (const auto &arena: arenas) {
+                if (arena->contains(chunk)) {
+                    return *arena;
+                }
+            }
+            return *arenas.back();
+        }
+
+    public:
+        explicit ChunkPool(const size_t chunkSize = CHUNK_SIZE, const size_t chunksPerArena = MAX_CHUNK_COUNT, const bool hugePages = CHUNK_HUGE_PAGES)
+            : chunkSize(chunkSize), chunksPerArena(chunksPerArena), hugePages(hugePages) {
+        }
+
+        ChunkPool(const ChunkPool &) = delete;
+        ChunkPool &operator=(const ChunkPool &) = delete;
+
+        [[nodiscard]] size_t getChunkSize() const noexcept { return chunkSize; }
+        [[nodiscard]] size_t getMemoryBudget() const noexcept { return budget; }
+
+        // Limits the bytes held by live chunks; chunks already handed out are never reclaimed.
+        void setMemoryBudget(const size_t bytes) noexcept { budget = bytes; }
+
+        [[nodiscard]] bool canAcquire(const size_t count = 1) const noexcept {
+            return (chunksInUse + count) * chunkSize <= budget;
+        }
+
+        char *acquire() noexcept {
+            const std::lock_guard lock(mutex);
+            if (!canAcquire()) {
+                ++failedAcquires;
+                return nullptr;
+            }
+            char *chunk = nullptr;
+            if (!freeChunks.empty()) {
+                chunk = freeChunks.back();
+                freeChunks.pop_back();
+                arenaOf(chunk).reuse(chunk);
+            } else {
+                chunk = acquireFromArena();
+                if (!chunk) {
+                    ++failedAcquires;
+                    return nullptr;
+                }
+            }
+            peakChunksInUse = std::max(peakChunksInUse, ++chunksInUse);
+            return chunk;
+        }
+
+        void release(char *chunk) noexcept {
+            if (!chunk) {
+                return;
+            }
+            const std::lock_guard lock(mutex);
+            freeChunks.push_back(chunk);
+            --chunksInUse;
+        }
+
+        // Returns the physical pages of free chunks to the OS and drops them from committedBytes; their address space
+        // stays reserved for reuse.
+        size_t trim() noexcept {
+            const std::lock_guard lock(mutex);
+            size_t released = 0;
+            for (char *chunk: freeChunks) {
+                released += arenaOf(chunk).discard(chunk);
+            }
+            return released;
+        }
+
+        [[nodiscard]] ChunkPoolStats getStats() const noexcept {
+            const std::lock_guard lock(mutex);
+            ChunkPoolStats stats;
+            stats.chunkSize = chunkSize;
+            for (const auto &arena: arenas) {
+                stats.reservedBytes += arena->reservedBytes();
+                stats.committedBytes += arena->committedBytes();
+                stats.hugePageBytes += arena->hugePageBytes();
+            }
+            stats.chunksInUse = chunksInUse;
+            stats.chunksFree = freeChunks.size();
+            stats.peakChunksInUse = peakChunksInUse;
+            stats.budgetBytes = budget;
+            stats.failedAcquires = failedAcquires;
+            return stats;
+        }
+    };
+}
@@ -5,6 +5,8 @@
 #pragma once
 
 #include <array>
+#include <bitset>
+#include <stdexcept>
 #include <vector>
 #include "ECS/Component/ComponentTypeInfo.hpp"
 
@@ -15,6 +17,12 @@ namespace ECS {
     public:
         void registerComponent(const ComponentTypeInfo type) {
             if (bitset.test(type.type)) {
+#ifndef NDEBUG
+                // Two types given the same static id.
+                if (components[type.type].size != type.size || components[type.type].alignment != type.alignment) {
+                    throw std::runtime_error("Component id collision");
+                }
+#endif
                 return;
             }
             components[type.type] = type;
@@ -29,6 +37,24 @@ namespace ECS {
             return bitset.test(type);
         }
 
+        // The storage policy is fixed when the type is registered.
+        [[nodiscard]] bool isSparse(const ComponentType type) const {
+            return bitset.test(type) && components[type].sparse;
+        }
+
+        // Archetypes read the hint when they are created; it has no effect on ones that already exist.
+        [[nodiscard]] bool isCold(const ComponentType type) const {
+            return bitset.test(type) && components[type].cold;
+        }
+
+        bool setCold(const ComponentType type, const bool cold = true) {
+            if (!bitset.test(type)) {
+                return false;
+            }
+            components[type].cold = cold;
+            return true;
+        }
+
         [[nodiscard]] const ComponentTypeInfo operator[](const ComponentType type) const {
             return components[type];
         }
@@ -39,12 +65,8 @@ namespace ECS {
 
         [[nodiscard]] std::vector<ComponentTypeInfo> getTypes(const Signature& bitset) const {
             std::vector<ComponentTypeInfo> types{};
-            types.reserve(bitset.highestBit - bitset.lowestBit + 1);
-            for (size_t i = bitset.lowestBit; i <= bitset.highestBit; ++i) {
-                if (bitset[i]) {
-                    types.push_back(components[i]);
-                }
-            }
+            types.reserve(bitset.count());
+            bitset.forEachSetBit([&](const ComponentType i) { types.push_back(components[i]); });
             return types;
         }
     };
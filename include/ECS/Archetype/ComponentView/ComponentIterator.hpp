@@ -27,6 +27,7 @@ namespace ECS {
 
         const std::vector<IterationMeta<N> > &chunks;
         size_t chunk_idx;
+        bool masked = false;
 
         void advanceToNextChunk() {
             if (++chunk_idx >= chunks.size()) {
@@ -42,6 +43,27 @@ namespace ECS {
 
             chunkEnd = currentPtrs[0] + meta.count * strides[0];
             remainingEntities = meta.count;
+            masked = meta.masked;
+        }
+
+        void step() {
+            for (size_t i = 0; i < N; ++i) {
+                currentPtrs[i] += strides[i];
+            }
+            if (--remainingEntities == 0) {
+                advanceToNextChunk();
+            }
+        }
+
+        // Moves past rows with a disabled component; only chunks with enable masks are checked.
+        void skipDisabled() {
+            while (masked && remainingEntities > 0) {
+                const auto &meta = chunks[chunk_idx];
+                if (isRowEnabled(meta, meta.count - remainingEntities)) {
+                    return;
+                }
+                step();
+            }
         }
 
         template<std::size_t... Is>
@@ -63,6 +85,8 @@ namespace ECS {
 
                 chunkEnd = currentPtrs[0] + meta.count * strides[0];
                 remainingEntities = meta.count;
+                masked = meta.masked;
+                skipDisabled();
             }
         }
 
@@ -75,12 +99,8 @@ namespace ECS {
         }
 
         ComponentIterator &operator++() {
-            for (size_t i = 0; i < N; ++i) {
-                currentPtrs[i] += strides[i];
-            }
-            if (--remainingEntities == 0) {
-                advanceToNextChunk();
-            }
+            step();
+            skipDisabled();
             return *this;
         }
 
@@ -48,6 +48,23 @@ namespace ECS {
             return func(*reinterpret_cast<Components *>(currentPtrs[Is])...);
         }
 
+        template<typename Func, std::size_t... Is>
+        bool callFuncAt(Func &&func, const size_t row, std::index_sequence<Is...>) {
+            return func(*reinterpret_cast<Components *>(currentPtrs[Is] + row * strides[Is])...);
+        }
+
+        // Visits the current chunk's enabled rows only.
+        template<typename Func>
+        bool forEachEnabled(Func &&func) {
+            bool result = false;
+            forEachEnabledRow(chunks[chunkIdx], [&](const size_t row) {
+                if (callFuncAt(func, row, std::make_index_sequence<N>{})) {
+                    result = true;
+                }
+            });
+            return result;
+        }
+
     public:
         explicit ForwardPointerReader(const std::vector<IterationMeta<N> > &chunks): chunks(chunks), chunkIdx(0), remainingEntities(0) {
             if (!chunks.empty()) {
@@ -65,15 +82,22 @@ namespace ECS {
         bool forEach(Func &&func) {
             bool result = false;
             while (remainingEntities > 0) {
-                if (callFunc(std::forward<Func>(func), std::make_index_sequence<N>{})) {
-                    result = true;
-                }
-                for (auto i = 0; i < N; ++i) {
-                    currentPtrs[i] += strides[i];
-                }
-                if (--remainingEntities == 0) {
+                if (chunks[chunkIdx].masked) {
+                    if (forEachEnabled(func)) {
+                        result = true;
+                    }
                     advanceToNextChunk();
+                    continue;
                 }
+                do {
+                    if (callFunc(std::forward<Func>(func), std::make_index_sequence<N>{})) {
+                        result = true;
+                    }
+                    for (auto i = 0; i < N; ++i) {
+                        currentPtrs[i] += strides[i];
+                    }
+                } while (--remainingEntities > 0);
+                advanceToNextChunk();
             }
             return result;
         }
@@ -81,6 +105,14 @@ namespace ECS {
         template<typename Func>
         void forEachParallel(Func &&func) {
             while (remainingEntities > 0) {
+                if (chunks[chunkIdx].masked) {
+                    forEachEnabled([&](Components &... components) {
+                        func(components...);
+                        return true;
+                    });
+                    advanceToNextChunk();
+                    continue;
+                }
                 std::array<char *, N> chunkPtrs = currentPtrs;
                 const size_t chunkSize = remainingEntities;
                 for (size_t entity = 0; entity < chunkSize; ++entity) {
@@ -101,6 +133,8 @@ namespace ECS {
 
     template<typename... Components>
     class ComponentView final {
+        static_assert((!kIsTag<Components> && ...), "Tags have no column to iterate; require them through the view's query instead");
+
         static const size_t N = sizeof...(Components);
         Signature signature = SignatureID<Components...>::signature();
         static std::array<ComponentType, N> makeComponentArray() { return { ComponentTypeID::get<Components>()... }; }
@@ -113,17 +147,24 @@ namespace ECS {
             iterationData.clear();
             for (auto i = 0; i < archetypes.size(); ++i) {
                 const auto &archetype = archetypes[i];
-                for (const Chunks::Chunk &chunk: archetype->getChunks()) {
+                const auto &chunks = archetype->getChunks();
+                for (size_t c = 0; c < chunks.size(); ++c) {
+                    const auto &chunk = chunks[c];
                     if (chunk.size == 0) {
                         continue;
                     }
                     IterationMeta<N> meta;
                     meta.count = chunk.size;
+                    meta.archetype = archetype;
+                    meta.chunk = c;
+                    meta.masked = false;
                     auto j = 0;
                     for (const auto type: components) {
                         const auto &component = chunk.components[type];
                         meta.ptrs[j] = component.ptr;
                         meta.stride[j] = component.stride;
+                        meta.enabled[j] = Chunks::enabledMask(chunk, type);
+                        meta.masked = meta.masked || meta.enabled[j];
                         ++j;
                     }
                     iterationData.push_back(meta);
@@ -131,6 +172,11 @@ namespace ECS {
             }
         }
 
+        template<typename Func, std::size_t... Is>
+        void invokeChunk(Func &&func, const IterationMeta<N> &meta, std::index_sequence<Is...>) const {
+            func(meta.count, reinterpret_cast<Components *>(meta.ptrs[Is])...);
+        }
+
         template<typename Func, std::size_t... Is>
         bool invoke(Func &&func, const IterationMeta<N> &meta, size_t index, std::index_sequence<Is...>) const {
             return func(*reinterpret_cast<Components *>(meta.ptrs[Is] + index * meta.stride[Is])...);
@@ -151,6 +197,38 @@ namespace ECS {
             return reader.forEach(std::forward<Func>(func));
         }
 
+        // Tests each chunk's `ChunkComponent` with `filter` before touching its rows, and calls func only for the
+        // entities of chunks that pass. Chunks of archetypes without the chunk component are skipped.
+        template<typename ChunkComponent, typename Filter, typename Func>
+        requires kIsChunkComponent<ChunkComponent> && std::predicate<Filter, const ChunkComponent &> && std::invocable<Func, Components&...>
+        bool forEach(Filter &&filter, Func &&func) {
+            const auto type = ComponentTypeID::get<ChunkComponent>();
+            bool result = false;
+            for (const auto &meta: iterationData) {
+                const auto *value = (*meta.archetype)[meta.chunk].components[type].ptr;
+                if (!value || !filter(*reinterpret_cast<const ChunkComponent *>(value))) {
+                    continue;
+                }
+                forEachEnabledRow(meta, [&](const size_t row) {
+                    if (invoke(func, meta, row, std::make_index_sequence<N>{})) {
+                        result = true;
+                    }
+                });
+            }
+            return result;
+        }
+
+        // Calls func(count, columns...) once per chunk. A shared component's pointer addresses the chunk's single value
+        // instead of a column, so per-value work can be hoisted out of the loop over rows; a chunk component's pointer
+        // lets func update the chunk's value from its rows. Every row is handed out, disabled components included.
+        template<typename Func>
+        requires std::invocable<Func, size_t, Components *...>
+        void forEachChunk(Func &&func) const {
+            for (const auto &meta: iterationData) {
+                invokeChunk(func, meta, std::make_index_sequence<N>{});
+            }
+        }
+
         ComponentIterator<Components...> begin() const { return ComponentIterator<Components...>(iterationData); }
         ComponentIterator<Components...> end() const { return ComponentIterator<Components...>(iterationData, true); }
     };
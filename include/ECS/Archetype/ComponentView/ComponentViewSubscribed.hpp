@@ -8,33 +8,42 @@
 #include "ECS/Archetype/ArchetypeStore.hpp"
 
 namespace ECS {
+    // A view over a query registered with the store. It keeps no callbacks: it compares the query's version before use
+    // and rebuilds its iteration data only when a matching archetype was added or changed. Must not outlive the store.
     template<typename... Components>
     class ComponentViewSubscribed final {
-        const Signature including = SignatureID<Components...>::signature();
         const std::unique_ptr<ArchetypeStore> &store;
-        const Signature excluding;
+        const RegisteredQuery *query;
+        uint64_t version = 0;
 
         std::unique_ptr<ComponentView<Components...> > view;
-        bool reloadData = true;
 
         const std::unique_ptr<ComponentView<Components...>>& getView() {
-            if (reloadData || !view) {
-                reloadData = false;
-                view = std::make_unique<ComponentView<Components...> >(store->findArchetypes(including, excluding));
+            if (!view || version != query->version) {
+                version = query->version;
+                view = std::make_unique<ComponentView<Components...> >(query->archetypes);
             }
             return view;
         }
 
     public:
-        explicit ComponentViewSubscribed(const std::unique_ptr<ArchetypeStore> &store, Signature excluding) : store(store), excluding(excluding) {
-            store->getChangeNotifier()->subscribeToUpdate([this](const auto archetype) {
-                const auto &signature = archetype->getSignature().bitset;
-                reloadData = (((including.bitset & signature) == signature) && (this->excluding.bitset & signature) == 0);
-            });
-            store->getChangeNotifier()->subscribeToAdd([this](const auto archetype) {
-                const auto &signature = archetype->getSignature().bitset;
-                reloadData = (((including.bitset & signature) == signature) && (this->excluding.bitset & signature) == 0);
-            });
+        // `required` adds components, e.g. tags, that matching entities must have but that are not iterated.
+        explicit ComponentViewSubscribed(const std::unique_ptr<ArchetypeStore> &store, const Signature &excluding, const Signature &required = {})
+            : store(store), query(store->acquireQuery(SignatureID<Components...>::signature() | required, excluding)) {
+        }
+
+        ComponentViewSubscribed(ComponentViewSubscribed &&other) noexcept
+            : store(other.store), query(std::exchange(other.query, nullptr)), version(other.version), view(std::move(other.view)) {
+        }
+
+        ComponentViewSubscribed(const ComponentViewSubscribed &) = delete;
+        ComponentViewSubscribed &operator=(const ComponentViewSubscribed &) = delete;
+        ComponentViewSubscribed &operator=(ComponentViewSubscribed &&) = delete;
+
+        ~ComponentViewSubscribed() {
+            if (query) {
+                store->releaseQuery(query);
+            }
         }
 
         ComponentIterator<Components...> begin() {
@@ -48,5 +57,15 @@ namespace ECS {
         template<typename Func>
         requires std::invocable<Func, Components&...>
         bool forEach(Func&& func) { return getView()->forEach(std::forward<Func>(func)); }
+
+        template<typename ChunkComponent, typename Filter, typename Func>
+        requires kIsChunkComponent<ChunkComponent> && std::predicate<Filter, const ChunkComponent &> && std::invocable<Func, Components&...>
+        bool forEach(Filter &&filter, Func &&func) {
+            return getView()->template forEach<ChunkComponent>(std::forward<Filter>(filter), std::forward<Func>(func));
+        }
+
+        template<typename Func>
+        requires std::invocable<Func, size_t, Components *...>
+        void forEachChunk(Func &&func) { getView()->forEachChunk(std::forward<Func>(func)); }
     };
 }
@@ -7,11 +7,60 @@
 
 #pragma once
 
+#include <bit>
+#include <cstdint>
+
 namespace ECS {
+    class Archetype;
+
     template <size_t N>
     struct IterationMeta {
         char *ptrs[N];
         size_t stride[N];
         size_t count;
+        // Enable masks of the enableable components, nullptr for the others; `masked` is set when any is present.
+        const uint64_t *enabled[N];
+        bool masked;
+        // Where the rows came from, so chunk components can be looked up without a column in the view.
+        const Archetype *archetype;
+        size_t chunk;
     };
+
+    // Calls func(row) for the rows whose enableable components are all enabled. The masks are ANDed 64 rows at a time
+    // and set bits are walked with countr_zero, so disabled runs cost one word each.
+    template<size_t N, typename Func>
+    void forEachEnabledRow(const IterationMeta<N> &meta, Func &&func) {
+        constexpr size_t kWordBits = 64;
+        const size_t words = (meta.count + kWordBits - 1) / kWordBits;
+        for (size_t word = 0; word < words; ++word) {
+            const size_t tail = meta.count - word * kWordBits;
+            uint64_t bits = tail >= kWordBits ? ~uint64_t{0} : (uint64_t{1} << tail) - 1;
+            for (size_t i = 0; i < N; ++i) {
+                if (meta.enabled[i]) {
+                    bits &= meta.enabled[i][word];
+                }
+            }
+            const size_t base = word * kWordBits;
+            if (bits == ~uint64_t{0}) {
+                for (size_t row = base; row < base + kWordBits; ++row) {
+                    func(row);
+                }
+                continue;
+            }
+            while (bits) {
+                func(base + std::countr_zero(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    template<size_t N>
+    [[nodiscard]] bool isRowEnabled(const IterationMeta<N> &meta, const size_t row) noexcept {
+        for (size_t i = 0; i < N; ++i) {
+            if (meta.enabled[i] && !((meta.enabled[i][row / 64] >> (row % 64)) & 1)) {
+                return false;
+            }
+        }
+        return true;
+    }
 }
@@ -0,0 +1,173 @@
+//
+//  SparseComponentView.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <utility>
+#include "ECS/Archetype/ArchetypeStore.hpp"
+
+namespace ECS {
+    // A view whose query touches sparse components. Entities are taken from the smallest sparse set the query requires,
+    // or from the rows of the matching archetypes when sparse components are only excluded, and each one is checked
+    // against the rest of the query before func sees it. Sparse components must not be added or removed while iterating.
+    // Must not outlive the store.
+    template<typename... Components>
+    class SparseComponentView final {
+        static_assert((!kIsTag<Components> && ...), "Tags have no value to iterate; require them through the view's query instead");
+
+        static constexpr size_t N = sizeof...(Components);
+
+        const std::unique_ptr<ArchetypeStore> &store;
+        const Signature including;
+        const Signature excluding;
+        // Registered for the plan's archetype part, and re-acquired only if that part changes.
+        mutable const RegisteredQuery *query = nullptr;
+        const std::array<ComponentType, N> components{ComponentTypeID::get<Components>()...};
+        static constexpr std::array<bool, N> kMasked{(kIsEnableable<Components> && !kIsSparse<Components>)...};
+
+        // The query split by storage; sparse types are only known once they are registered, so this is redone per call.
+        struct Plan {
+            Signature including;
+            Signature excluding;
+            std::vector<const SparseSet *> required;
+            std::vector<const SparseSet *> excluded;
+            std::array<SparseSet *, N> sets{};
+            bool empty = false;
+        };
+
+        [[nodiscard]] Plan makePlan() const {
+            Plan plan;
+            including.forEachSetBit([&](const ComponentType type) {
+                if (!store->isSparse(type)) {
+                    plan.including.set(type);
+                } else if (const auto *set = store->getSparseSet(type)) {
+                    plan.required.push_back(set);
+                } else {
+                    plan.empty = true;
+                }
+            });
+            excluding.forEachSetBit([&](const ComponentType type) {
+                if (!store->isSparse(type)) {
+                    plan.excluding.set(type);
+                } else if (const auto *set = store->getSparseSet(type)) {
+                    plan.excluded.push_back(set);
+                }
+            });
+            for (size_t i = 0; i < N; ++i) {
+                plan.sets[i] = store->getSparseSet(components[i]);
+            }
+            return plan;
+        }
+
+        [[nodiscard]] const std::vector<const Archetype *> &archetypesFor(const Plan &plan) const {
+            if (!query || query->including != plan.including || query->excluding != plan.excluding) {
+                if (const auto *previous = std::exchange(query, store->acquireQuery(plan.including, plan.excluding))) {
+                    store->releaseQuery(previous);
+                }
+            }
+            return query->archetypes;
+        }
+
+        template<typename Component>
+        static Component &fetch(const Chunks::Chunk &chunk, const size_t row, const Entity entity, SparseSet *set, const ComponentType type) {
+            if constexpr (kIsSparse<Component>) {
+                return *static_cast<Component *>(set->get(entity));
+            } else {
+                const auto &column = chunk.components[type];
+                return *reinterpret_cast<Component *>(column.ptr + row * column.stride);
+            }
+        }
+
+        template<typename Func, std::size_t... Is>
+        bool invoke(Func &&func, const Plan &plan, const Chunks::Chunk &chunk, const size_t row, const Entity entity,
+                    std::index_sequence<Is...>) const {
+            return func(fetch<Components>(chunk, row, entity, plan.sets[Is], components[Is])...);
+        }
+
+        [[nodiscard]] bool enabled(const Chunks::Chunk &chunk, const size_t row) const noexcept {
+            for (size_t i = 0; i < N; ++i) {
+                if (kMasked[i] && !Chunks::testBit(Chunks::enabledMask(chunk, components[i]), row)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        [[nodiscard]] static bool passes(const Plan &plan, const Entity entity, const SparseSet *driver) noexcept {
+            for (const auto *set: plan.required) {
+                if (set != driver && !set->contains(entity)) {
+                    return false;
+                }
+            }
+            for (const auto *set: plan.excluded) {
+                if (set->contains(entity)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    public:
+        // `required` adds components, e.g. sparse tags, that matching entities must have but that are not iterated.
+        explicit SparseComponentView(const std::unique_ptr<ArchetypeStore> &store, const Signature &excluding, const Signature &required = {})
+            : store(store), including(SignatureID<Components...>::signature() | required), excluding(excluding) {
+        }
+
+        SparseComponentView(SparseComponentView &&other) noexcept
+            : store(other.store), including(other.including), excluding(other.excluding), query(std::exchange(other.query, nullptr)) {
+        }
+
+        SparseComponentView(const SparseComponentView &) = delete;
+        SparseComponentView &operator=(const SparseComponentView &) = delete;
+        SparseComponentView &operator=(SparseComponentView &&) = delete;
+
+        ~SparseComponentView() {
+            if (query) {
+                store->releaseQuery(query);
+            }
+        }
+
+        template<typename Func>
+        requires std::invocable<Func, Components&...>
+        bool forEach(Func &&func) const {
+            const auto plan = makePlan();
+            if (plan.empty) {
+                return false;
+            }
+            bool result = false;
+            if (plan.required.empty()) {
+                for (const auto *archetype: archetypesFor(plan)) {
+                    for (const auto &chunk: archetype->getChunks()) {
+                        const auto *entities = reinterpret_cast<const Entity *>(chunk.components[0].ptr);
+                        for (size_t row = 0; row < chunk.size; ++row) {
+                            if (passes(plan, entities[row], nullptr) && enabled(chunk, row) &&
+                                invoke(func, plan, chunk, row, entities[row], std::make_index_sequence<N>{})) {
+                                result = true;
+                            }
+                        }
+                    }
+                }
+                return result;
+            }
+
+            const auto *driver = *std::ranges::min_element(plan.required, std::less{}, &SparseSet::count);
+            for (const auto entity: driver->getEntities()) {
+                const auto &record = store->getRecord(entity);
+                if (!record.archetype || !passes(plan, entity, driver)) {
+                    continue;
+                }
+                if (!record.archetype->getSignature().matches(plan.including, plan.excluding)) {
+                    continue;
+                }
+                const auto &chunk = (*record.archetype)[record.location.chunkIndex];
+                if (enabled(chunk, record.location.indexInChunk) &&
+                    invoke(func, plan, chunk, record.location.indexInChunk, entity, std::make_index_sequence<N>{})) {
+                    result = true;
+                }
+            }
+            return result;
+        }
+    };
+}
@@ -0,0 +1,26 @@
+//
+//  EntityLocation.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <ECS/EntityTable.hpp>
+#include "Chunks/Chunk.hpp"
+
+namespace ECS {
+    class Archetype;
+
+    struct EntityLocation {
+        Chunks::Index chunkIndex{};
+        size_t indexInChunk{};
+    };
+
+    struct EntityRecord {
+        Archetype *archetype = nullptr;
+        EntityLocation location{};
+    };
+
+    // Single source of truth for where every entity lives; shared by the store and all of its archetypes.
+    using EntityLocations = EntityTable<EntityRecord>;
+}
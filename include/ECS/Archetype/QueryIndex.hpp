@@ -0,0 +1,116 @@
+//
+//  QueryIndex.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "Archetype.hpp"
+
+namespace ECS {
+    // A query shared by every view that asks for the same component sets. `archetypes` lists the matching archetypes, and
+    // `version` changes whenever one is added or changes structurally, so views rebuild their iteration data only then.
+    struct RegisteredQuery {
+        Signature including;
+        Signature excluding;
+        std::vector<const Archetype *> archetypes;
+        uint64_t version = 0;
+        size_t users = 0;
+    };
+
+    // Keeps registered queries up to date as archetypes appear: a new archetype is tested only against the queries
+    // filed under one of its components (each query is filed under its highest included component), and a structural
+    // change bumps the queries of that one archetype.
+    class QueryIndex final {
+        using Key = std::pair<Signature, Signature>;
+
+        struct KeyHash {
+            size_t operator()(const Key &key) const noexcept {
+                const std::hash<Signature> hash;
+                return hash(key.first) ^ hash(key.second) * 0x9E3779B97F4A7C15ULL;
+            }
+        };
+
+        std::unordered_map<Key, std::unique_ptr<RegisteredQuery>, KeyHash> queries;
+        std::array<std::vector<RegisteredQuery *>, MAX_COMPONENTS> byComponent;
+        // Queries including nothing match every archetype.
+        std::vector<RegisteredQuery *> unfiled;
+        std::unordered_map<const Archetype *, std::vector<RegisteredQuery *> > byArchetype;
+
+        [[nodiscard]] std::vector<RegisteredQuery *> &bucket(const RegisteredQuery &query) {
+            return query.including.none() ? unfiled : byComponent[query.including.highestBit];
+        }
+
+        void link(RegisteredQuery &query, const Archetype *archetype) {
+            query.archetypes.push_back(archetype);
+            byArchetype[archetype].push_back(&query);
+            ++query.version;
+        }
+
+    public:
+        [[nodiscard]] RegisteredQuery *find(const Signature &including, const Signature &excluding) const {
+            const auto it = queries.find({including, excluding});
+            return it != queries.end() ? it->second.get() : nullptr;
+        }
+
+        // Registers a query; `matching` are the archetypes that already match it.
+        RegisteredQuery *add(const Signature &including, const Signature &excluding, const std::vector<const Archetype *> &matching) {
+            auto registered = std::make_unique<RegisteredQuery>(RegisteredQuery{including, excluding, {}, 0, 0});
+            auto &query = *queries.emplace(Key{including, excluding}, std::move(registered)).first->second;
+            for (const auto *archetype: matching) {
+                link(query, archetype);
+            }
+            bucket(query).push_back(&query);
+            return &query;
+        }
+
+        void release(const RegisteredQuery *released) {
+            const auto it = queries.find({released->including, released->excluding});
+            if (it == queries.end() || it->second.get() != released) {
+                return;
+            }
+            auto *query = it->second.get();
+            if (--query->users > 0) {
+                return;
+            }
+            for (const auto *archetype: query->archetypes) {
+                std::erase(byArchetype[archetype], query);
+            }
+            std::erase(bucket(*query), query);
+            queries.erase(it);
+        }
+
+        // A query registered while the archetype's notification was held back by a batch has already linked it.
+        void onAdd(const Archetype *archetype) {
+            const auto &signature = archetype->getSignature();
+            const auto linked = byArchetype.find(archetype);
+            const auto test = [&](RegisteredQuery *query) {
+                if (linked != byArchetype.end() && std::ranges::find(linked->second, query) != linked->second.end()) {
+                    return;
+                }
+                if (signature.matches(query->including, query->excluding)) {
+                    link(*query, archetype);
+                }
+            };
+            std::ranges::for_each(unfiled, test);
+            signature.forEachSetBit([&](const ComponentType type) { std::ranges::for_each(byComponent[type], test); });
+        }
+
+        void onUpdate(const Archetype *archetype) {
+            const auto it = byArchetype.find(archetype);
+            if (it == byArchetype.end()) {
+                return;
+            }
+            for (auto *query: it->second) {
+                ++query->version;
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return queries.size(); }
+    };
+}
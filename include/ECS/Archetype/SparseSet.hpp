@@ -0,0 +1,97 @@
+//
+//  SparseSet.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <cstring>
+#include <span>
+#include <vector>
+#include <ECS/EntityTable.hpp>
+
+namespace ECS {
+    // Type-erased storage for one sparse component: values are packed densely next to their entities, and an
+    // entity-indexed table maps each entity to its slot. Adding, overwriting and removing are O(1); removal moves the
+    // last value into the freed slot, so pointers into the set stay valid only until the next add or remove.
+    class SparseSet final {
+        const uint16_t size;
+        // Slot + 1, so the zero a fresh table page reads as means "absent".
+        EntityTable<uint32_t> slots;
+        std::vector<Entity> entities;
+        std::vector<std::byte> values;
+
+    public:
+        // Values live in plain byte storage, which is aligned for anything up to max_align_t.
+        explicit SparseSet(const uint16_t size) : size(size) {
+        }
+
+        SparseSet(const SparseSet &) = delete;
+        SparseSet &operator=(const SparseSet &) = delete;
+
+        [[nodiscard]] bool contains(const Entity entity) const noexcept { return slots.get(entity) != 0; }
+
+        [[nodiscard]] void *get(const Entity entity) noexcept {
+            const auto slot = slots.get(entity);
+            if (slot == 0) {
+                return nullptr;
+            }
+            return values.data() + (slot - 1) * size;
+        }
+
+        [[nodiscard]] const void *get(const Entity entity) const noexcept {
+            return const_cast<SparseSet *>(this)->get(entity);
+        }
+
+        // Inserts or overwrites; `value` may be nullptr for components without data.
+        void set(const Entity entity, const void *value) {
+            auto &slot = slots[entity];
+            if (slot == 0) {
+                entities.push_back(entity);
+                if (size > 0) {
+                    values.resize(values.size() + size);
+                }
+                slot = static_cast<uint32_t>(entities.size());
+            }
+            if (size > 0 && value) {
+                std::memcpy(values.data() + (slot - 1) * size, value, size);
+            }
+        }
+
+        bool erase(const Entity entity) noexcept {
+            if (!contains(entity)) {
+                return false;
+            }
+            auto &slot = slots[entity];
+            const auto index = slot - 1;
+            const auto last = entities.size() - 1;
+            if (index != last) {
+                entities[index] = entities[last];
+                if (size > 0) {
+                    std::memcpy(values.data() + index * size, values.data() + last * size, size);
+                }
+                slots[entities[index]] = index + 1;
+            }
+            slot = 0;
+            entities.pop_back();
+            if (size > 0) {
+                values.erase(values.end() - static_cast<std::ptrdiff_t>(size), values.end());
+            }
+            return true;
+        }
+
+        void clear() noexcept {
+            for (const auto entity: entities) {
+                slots[entity] = 0;
+            }
+            entities.clear();
+            values.clear();
+        }
+
+        [[nodiscard]] size_t count() const noexcept { return entities.size(); }
+        [[nodiscard]] std::span<const Entity> getEntities() const noexcept { return entities; }
+        [[nodiscard]] size_t memoryBytes() const noexcept {
+            return slots.memoryBytes() + entities.capacity() * sizeof(Entity) + values.capacity();
+        }
+    };
+}
@@ -8,30 +8,60 @@
 #pragma once
 
 #include <atomic>
+#include <stdexcept>
 #include "ComponentTypeInfo.hpp"
 #include <Templates.hpp>
 
+ECS_COMPONENT_ID(ECS::Entity, 0);
+
 namespace ECS {
+    static_assert(ECS_STATIC_COMPONENT_IDS < MAX_COMPONENTS, "ECS_STATIC_COMPONENT_IDS leaves no ids for other components");
+
     class ComponentTypeID final {
 
-        static inline std::atomic<uint32_t> counter{0};
+        static inline std::atomic<uint32_t> counter{ECS_STATIC_COMPONENT_IDS};
 
-        template<typename T>
-        static ComponentTypeIndex get() {
-            using DecayedT = decay<T>;
-            static ComponentTypeIndex id = getID<DecayedT>();
+        // The guarded path, taken only until runtimeID<DecayedT> has been initialized.
+        template<typename DecayedT>
+        static ComponentTypeIndex assign() {
+            static const auto id = [] {
+                const auto next = counter.fetch_add(1, std::memory_order_relaxed);
+#ifndef NDEBUG
+                if (next >= MAX_COMPONENTS) {
+                    throw std::runtime_error("Too many component types; raise MAX_COMPONENTS");
+                }
+#endif
+                return static_cast<ComponentTypeIndex>(next);
+            }();
             return id;
         }
 
+        // Initialized with the other globals, so lookups after startup are a plain load; 0 means not yet.
         template<typename DecayedT>
-        static constexpr ComponentTypeIndex getID() {
-            static const uint32_t id = counter.fetch_add(1, std::memory_order_relaxed);
-            return id;
+        static inline ComponentTypeIndex runtimeID = assign<DecayedT>();
+
+        template<typename T>
+        static constexpr ComponentTypeIndex get() {
+            using DecayedT = decay<T>;
+            if constexpr (kHasStaticID<DecayedT>) {
+                constexpr auto id = StaticComponentID<DecayedT>::value;
+                static_assert(id < ECS_STATIC_COMPONENT_IDS, "Static component ids must be below ECS_STATIC_COMPONENT_IDS");
+                return id;
+            } else {
+                if (const auto id = runtimeID<DecayedT>) [[likely]] {
+                    return id;
+                }
+                return assign<DecayedT>();
+            }
         }
 
         template<typename T>
         static constexpr ComponentTypeInfo getTypeInfo() {
-            return {get<T>(), sizeof(T), alignof(T)};
+            const void *initial = nullptr;
+            if constexpr (kIsChunkComponent<T>) {
+                initial = &chunkInitial<T>;
+            }
+            return {get<T>(), static_cast<uint16_t>(kIsTag<T> ? 0 : sizeof(T)), alignof(T), kIsShared<T>, kIsChunkComponent<T>, initial, kIsSparse<T>, kIsEnableable<T>, kIsCold<T>};
         }
 
         template<typename... Components>
@@ -47,6 +77,8 @@ namespace ECS {
         template<typename... Components>
         friend class ComponentView;
         template<typename... Components>
+        friend class SparseComponentView;
+        template<typename... Components>
         friend class SignatureID;
     };
 
@@ -58,6 +90,17 @@ namespace ECS {
             return signature;
         }
 
+        // Built at compile time when every component has a static id.
+        static const Signature &cached() {
+            if constexpr ((kHasStaticID<Components> && ...)) {
+                static constexpr Signature kSignature = signature();
+                return kSignature;
+            } else {
+                static const Signature kSignature = signature();
+                return kSignature;
+            }
+        }
+
         friend class Archetype;
         friend class ArchetypeStore;
         friend class EntityManager;
@@ -65,5 +108,8 @@ namespace ECS {
         friend class ComponentViewSubscribed;
         template<typename... C>
         friend class ComponentView;
+        template<typename... C>
+        friend class SparseComponentView;
     };
 }
+
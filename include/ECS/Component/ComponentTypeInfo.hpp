@@ -7,17 +7,111 @@
 
 #pragma once
 
+#include <type_traits>
 #include <ECS/Entity.h>
 
 namespace ECS {
+    // size is 0 for tags: components without fields, which exist only in an archetype's signature and take no column.
+    // Shared components store one value per chunk instead of one per entity. Chunk components do too, but belong to
+    // the chunk rather than to its entities: `initial` is copied into every new chunk. Sparse components are kept out of
+    // archetypes altogether, in a set keyed by entity. Enableable components get a per-chunk bitmask next to their column.
+    // Cold columns are moved out of the chunk into a companion block with the same rows.
     struct ComponentTypeInfo {
         ComponentType type;
         uint16_t size;
         uint16_t alignment;
+        bool shared = false;
+        bool chunk = false;
+        const void *initial = nullptr;
+        bool sparse = false;
+        bool enableable = false;
+        bool cold = false;
     };
 
+    // Specialize, or declare `static constexpr bool kShared = true;` in the component, to make it shared: entities of
+    // an archetype are grouped into chunks by its value, and each chunk stores the value once.
+    template<typename Component>
+    struct IsSharedComponent : std::bool_constant<requires { requires Component::kShared; }> {
+    };
+
+    template<typename Component>
+    inline constexpr bool kIsShared = IsSharedComponent<std::decay_t<Component> >::value;
+
+    // Specialize, or declare `static constexpr bool kChunk = true;` in the component, to attach it to chunks: each chunk
+    // of an archetype holds one value, e.g. bounds of its entities, that systems maintain and queries can test to skip
+    // the whole chunk. Entities are not grouped by it and moving rows between chunks leaves it alone.
+    template<typename Component>
+    struct IsChunkComponent : std::bool_constant<requires { requires Component::kChunk; }> {
+    };
+
+    template<typename Component>
+    inline constexpr bool kIsChunkComponent = IsChunkComponent<std::decay_t<Component> >::value;
+
+    // Specialize, or declare `static constexpr bool kSparse = true;` in the component, for components that are added and
+    // removed every few frames: they live in a sparse set keyed by entity, so toggling one never moves the entity to
+    // another archetype. Views join them with archetype columns entity by entity.
+    template<typename Component>
+    struct IsSparseComponent : std::bool_constant<requires { requires Component::kSparse; }> {
+    };
+
+    template<typename Component>
+    inline constexpr bool kIsSparse = IsSparseComponent<std::decay_t<Component> >::value;
+
+    // Specialize, or declare `static constexpr bool kEnableable = true;` in the component, to switch it off and on per
+    // entity without a structural change: views skip entities for which one of the iterated components is disabled.
+    // Components start enabled.
+    template<typename Component>
+    struct IsEnableableComponent : std::bool_constant<requires { requires Component::kEnableable; }> {
+    };
+
+    template<typename Component>
+    inline constexpr bool kIsEnableable = IsEnableableComponent<std::decay_t<Component> >::value;
+
+    // Specialize, or declare `static constexpr bool kCold = true;` in the component, for large components that most
+    // systems skip: their columns go to a companion block next to each chunk, so the chunk fits more rows of the rest.
+    template<typename Component>
+    struct IsColdComponent : std::bool_constant<requires { requires Component::kCold; }> {
+    };
+
+    template<typename Component>
+    inline constexpr bool kIsCold = IsColdComponent<std::decay_t<Component> >::value;
+
+    // Specialize with ECS_COMPONENT_ID(Type, id), or declare `static constexpr ComponentType kComponentID = id;` in the
+    // component, to fix its type id at compile time: the id is the same in every build and run, and lookups fold to a
+    // constant. Only annotated components get this; the others get ids in order of first use, starting at
+    // ECS_STATIC_COMPONENT_IDS, so they never land in the static range. Ids must be unique and below
+    // ECS_STATIC_COMPONENT_IDS; 0 is Entity. Uniqueness is not checked at compile time: debug builds only catch two
+    // types of different size or alignment registering the same id with one registry.
+    template<typename Component>
+    struct StaticComponentID : std::integral_constant<int32_t, -1> {
+    };
+
+    template<typename Component> requires requires { Component::kComponentID; }
+    struct StaticComponentID<Component> : std::integral_constant<int32_t, Component::kComponentID> {
+    };
+
+    template<typename Component>
+    inline constexpr bool kHasStaticID = StaticComponentID<std::decay_t<Component> >::value >= 0;
+
+    // Value a new chunk starts with.
+    template<typename Component>
+    inline const std::decay_t<Component> chunkInitial{};
+
+    template<typename Component>
+    inline constexpr bool kIsTag = std::is_empty_v<std::decay_t<Component> >;
+
+    // Tags carry no state, so code that needs a reference to one gets this shared instance.
+    template<typename Component>
+    inline std::decay_t<Component> tagInstance{};
+
     struct ComponentInfo {
         const ComponentTypeInfo type;
         const char *component;
     };
 }
+
+// Use at global scope.
+#define ECS_COMPONENT_ID(Type, ID) \
+    template<> \
+    struct ECS::StaticComponentID<Type> : std::integral_constant<int32_t, (ID)> { \
+    }
@@ -1,134 +1,185 @@
 #pragma once
 
-#include <bitset>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <limits>
 
 namespace ECS {
+    // A component set stored as 64-bit words. Set bits are visited with countr_zero, set tests are a few word-wise
+    // ands, and the hash is kept up to date as bits change, so archetype lookups don't rehash the words.
     template <uint16_t MaxComponents>
     struct SignatureBitset {
-        std::bitset<MaxComponents> bitset;
+        static constexpr size_t kWordBits = 64;
+        static constexpr size_t kWords = (MaxComponents + kWordBits - 1) / kWordBits;
+
+        std::array<uint64_t, kWords> words{};
         uint16_t lowestBit = std::numeric_limits<uint16_t>::max();
         uint16_t highestBit = 0;
+        // Xor of a mixed value per set bit, so setting and clearing a bit are O(1) and equal sets hash equally.
+        size_t hash = 0;
+
+    private:
+        [[nodiscard]] static constexpr size_t mix(const size_t bit) noexcept {
+            uint64_t x = bit + 0x9E3779B97F4A7C15ULL;
+            x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+            return static_cast<size_t>(x ^ (x >> 31));
+        }
+
+        constexpr void rehash() noexcept {
+            hash = 0;
+            forEachSetBit([&](const uint16_t bit) { hash ^= mix(bit); });
+        }
+
+    public:
+        constexpr void set(std::size_t bit) {
+            assert(bit < MaxComponents);
+            auto &word = words[bit / kWordBits];
+            const uint64_t mask = uint64_t{1} << (bit % kWordBits);
+            if (word & mask) {
+                return;
+            }
+            word |= mask;
+            hash ^= mix(bit);
+            lowestBit = std::min(lowestBit, static_cast<uint16_t>(bit));
+            highestBit = std::max(highestBit, static_cast<uint16_t>(bit));
+        }
 
-        void set(std::size_t bit) {
-            bitset.set(bit);
-            if (bit < lowestBit) {
-                lowestBit = static_cast<uint16_t>(bit);
+        constexpr void reset(std::size_t bit) {
+            assert(bit < MaxComponents);
+            auto &word = words[bit / kWordBits];
+            const uint64_t mask = uint64_t{1} << (bit % kWordBits);
+            if (!(word & mask)) {
+                return;
             }
-            if (bit > highestBit) {
-                highestBit = static_cast<uint16_t>(bit);
+            word &= ~mask;
+            hash ^= mix(bit);
+            if (bit == lowestBit || bit == highestBit) {
+                recalcBounds();
             }
         }
 
-        void reset(std::size_t bit) {
-            bitset.reset(bit);
-            if (bit == lowestBit) {
-                bool found = false;
-                for (uint16_t i = static_cast<uint16_t>(bit) + 1; i < MaxComponents; ++i) {
-                    if (bitset.test(i)) {
-                        lowestBit = i;
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    lowestBit = std::numeric_limits<uint16_t>::max();
-                    highestBit = 0;
-                }
+        [[nodiscard]] constexpr bool none() const {
+            uint64_t any = 0;
+            for (const auto word: words) {
+                any |= word;
             }
+            return any == 0;
+        }
 
-            if (bit == highestBit) {
-                bool found = false;
-                for (int i = static_cast<int>(bit) - 1; i >= 0; --i) {
-                    if (bitset.test(static_cast<size_t>(i))) {
-                        highestBit = static_cast<uint16_t>(i);
-                        found = true;
-                        break;
-                    }
-                }
-                if (!found) {
-                    highestBit = 0;
-                    if (!bitset.any()) {
-                        lowestBit = std::numeric_limits<uint16_t>::max();
-                    }
+        template<typename Func>
+        constexpr void forEachSetBit(Func f) const {
+            for (size_t w = 0; w < kWords; ++w) {
+                for (uint64_t word = words[w]; word != 0; word &= word - 1) {
+                    f(static_cast<uint16_t>(w * kWordBits + std::countr_zero(word)));
                 }
             }
         }
 
-        [[nodiscard]] inline bool none() const { return bitset.none(); }
-
-        template<typename Func>
-        void forEachSetBit(Func f) const {
-            if (none()) return;
+        constexpr bool operator[](std::size_t pos) const { return test(pos); }
 
-            for (uint16_t i = lowestBit; i <= highestBit; ++i) {
-                if (bitset.test(i)) {
-                    f(i);
-                }
+        [[nodiscard]] constexpr size_t count() const {
+            size_t count = 0;
+            for (const auto word: words) {
+                count += std::popcount(word);
             }
+            return count;
         }
 
-        bool operator[](std::size_t pos) const { return bitset.test(pos); }
-        typename std::bitset<MaxComponents>::reference operator[](std::size_t pos) { return bitset[pos]; }
+        [[nodiscard]] constexpr bool test(std::size_t pos) const {
+            assert(pos < MaxComponents);
+            return (words[pos / kWordBits] >> (pos % kWordBits)) & 1;
+        }
 
-        [[nodiscard]] inline size_t count() const { return bitset.count(); }
-        [[nodiscard]] inline bool test(std::size_t pos) const { return bitset.test(pos); }
+        // Every bit of `other` is set here.
+        [[nodiscard]] constexpr bool contains(const SignatureBitset &other) const {
+            uint64_t missing = 0;
+            for (size_t w = 0; w < kWords; ++w) {
+                missing |= other.words[w] & ~words[w];
+            }
+            return missing == 0;
+        }
 
-        void recalcBounds() {
-            if (bitset.none()) {
-                lowestBit = std::numeric_limits<uint16_t>::max();
-                highestBit = 0;
-                return;
+        [[nodiscard]] constexpr bool intersects(const SignatureBitset &other) const {
+            uint64_t common = 0;
+            for (size_t w = 0; w < kWords; ++w) {
+                common |= words[w] & other.words[w];
             }
+            return common != 0;
+        }
 
-            for (uint16_t i = 0; i < MaxComponents; ++i) {
-                if (bitset.test(i)) {
-                    lowestBit = i;
+        // Contains all of `including` and none of `excluding`.
+        [[nodiscard]] constexpr bool matches(const SignatureBitset &including, const SignatureBitset &excluding) const {
+            uint64_t mismatch = 0;
+            for (size_t w = 0; w < kWords; ++w) {
+                mismatch |= (including.words[w] & ~words[w]) | (excluding.words[w] & words[w]);
+            }
+            return mismatch == 0;
+        }
+
+        constexpr void recalcBounds() {
+            lowestBit = std::numeric_limits<uint16_t>::max();
+            highestBit = 0;
+            for (size_t w = 0; w < kWords; ++w) {
+                if (words[w] != 0) {
+                    lowestBit = static_cast<uint16_t>(w * kWordBits + std::countr_zero(words[w]));
                     break;
                 }
             }
-
-            for (int i = MaxComponents - 1; i >= 0; --i) {
-                if (bitset.test(i)) {
-                    highestBit = static_cast<uint16_t>(i);
+            for (size_t w = kWords; w-- > 0;) {
+                if (words[w] != 0) {
+                    highestBit = static_cast<uint16_t>(w * kWordBits + kWordBits - 1 - std::countl_zero(words[w]));
                     break;
                 }
             }
         }
 
-        SignatureBitset& operator&=(const SignatureBitset& other) {
-            bitset &= other.bitset;
+        constexpr SignatureBitset& operator&=(const SignatureBitset& other) {
+            for (size_t w = 0; w < kWords; ++w) {
+                words[w] &= other.words[w];
+            }
             recalcBounds();
+            rehash();
             return *this;
         }
 
-        SignatureBitset& operator|=(const SignatureBitset& other) {
-            bitset |= other.bitset;
+        constexpr SignatureBitset& operator|=(const SignatureBitset& other) {
+            for (size_t w = 0; w < kWords; ++w) {
+                words[w] |= other.words[w];
+            }
             lowestBit = std::min(lowestBit, other.lowestBit);
             highestBit = std::max(highestBit, other.highestBit);
+            rehash();
             return *this;
         }
 
-        friend SignatureBitset operator&(const SignatureBitset& lhs, const SignatureBitset& rhs) {
-            SignatureBitset result;
-            result.bitset = lhs.bitset & rhs.bitset;
-            result.recalcBounds();
+        friend constexpr SignatureBitset operator&(const SignatureBitset& lhs, const SignatureBitset& rhs) {
+            SignatureBitset result = lhs;
+            result &= rhs;
             return result;
         }
 
-        friend SignatureBitset operator|(const SignatureBitset& lhs, const SignatureBitset& rhs) {
-            SignatureBitset result;
-            result.bitset = lhs.bitset | rhs.bitset;
-            result.recalcBounds();
+        friend constexpr SignatureBitset operator|(const SignatureBitset& lhs, const SignatureBitset& rhs) {
+            SignatureBitset result = lhs;
+            result |= rhs;
             return result;
         }
 
-        friend bool operator==(const SignatureBitset& lhs, const SignatureBitset& rhs) {
-            return lhs.bitset == rhs.bitset;
+        friend constexpr bool operator==(const SignatureBitset& lhs, const SignatureBitset& rhs) {
+            return lhs.hash == rhs.hash && lhs.words == rhs.words;
         }
 
-        bool operator<(const SignatureBitset& other) const {
-            return bitset < other.bitset;
+        constexpr bool operator<(const SignatureBitset& other) const {
+            for (size_t w = kWords; w-- > 0;) {
+                if (words[w] != other.words[w]) {
+                    return words[w] < other.words[w];
+                }
+            }
+            return false;
         }
     };
 }
@@ -137,7 +188,7 @@ namespace std {
     template <uint16_t MaxComponents>
     struct hash<ECS::SignatureBitset<MaxComponents>> {
         size_t operator()(const ECS::SignatureBitset<MaxComponents>& wrapper) const {
-            return std::hash<std::bitset<MaxComponents>>{}(wrapper.bitset);
+            return wrapper.hash;
         }
     };
-}
\ No newline at end of file
+}
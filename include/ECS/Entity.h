@@ -18,10 +18,20 @@
 #define CHUNK_SIZE (128 * 1024)
 #endif
 
+#ifndef CHUNK_HUGE_PAGES
+#define CHUNK_HUGE_PAGES 0
+#endif
+
 #ifndef MAX_CHUNK_COUNT
 #define MAX_CHUNK_COUNT 1024
 #endif
 
+// Component ids below this are left to ECS_COMPONENT_ID; ids of other components are handed out from here on.
+// Set by the ECS_STATIC_COMPONENT_IDS CMake option like the other limits; the default is for builds without it.
+#ifndef ECS_STATIC_COMPONENT_IDS
+#define ECS_STATIC_COMPONENT_IDS 16
+#endif
+
 #ifndef MAX_ENTITIES
 #define MAX_ENTITIES 10000000
 #endif
@@ -0,0 +1,363 @@
+//
+//  EntityCommandBuffer.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "EntityManager.hpp"
+
+namespace ECS {
+    class ParallelCommandBuffer;
+
+    // Records structural changes so they can be applied at a sync point, e.g. once a system has finished iterating its view.
+    // Component values are copied into an arena owned by the buffer and stay there until playback() or clear().
+    class EntityCommandBuffer final {
+        friend class ParallelCommandBuffer;
+
+        enum class CommandKind : uint8_t {
+            Create,
+            Set,
+            Remove,
+            Destroy
+        };
+
+        struct Command {
+            using Apply = void (*)(ArchetypeStore &, Entity, void *);
+            using Discard = void (*)(void *);
+            // Applies a run of commands of the same type, one per entity; returns how many of the leading ones it handled.
+            using Batch = size_t (*)(ArchetypeStore &, std::span<const Entity>, std::span<const Command *const>);
+
+            Apply apply;
+            Discard discard;
+            Batch batch;
+            void *payload;
+            Entity entity;
+            CommandKind kind;
+        };
+
+        // Bump allocator over fixed-size blocks; blocks are kept for reuse after the buffer is cleared.
+        class Arena final {
+            static constexpr size_t kBlockSize = 64 * 1024;
+
+            std::vector<std::unique_ptr<std::byte[]> > blocks;
+            size_t block = 0;
+            size_t offset = 0;
+
+        public:
+            static constexpr size_t kMaxAllocation = kBlockSize / 4;
+
+            void *allocate(const size_t size, const size_t alignment) {
+                while (true) {
+                    if (block == blocks.size()) {
+                        blocks.push_back(std::make_unique<std::byte[]>(kBlockSize));
+                    }
+                    const auto base = reinterpret_cast<uintptr_t>(blocks[block].get());
+                    const auto aligned = (base + offset + alignment - 1) & ~(alignment - 1);
+                    const auto end = aligned - base + size;
+                    if (end <= kBlockSize) {
+                        offset = end;
+                        return reinterpret_cast<void *>(aligned);
+                    }
+                    ++block;
+                    offset = 0;
+                }
+            }
+
+            void reset() noexcept {
+                block = 0;
+                offset = 0;
+            }
+
+            [[nodiscard]] size_t memoryBytes() const noexcept { return blocks.size() * kBlockSize; }
+        };
+
+        // Commands recorded after setSortKey() until the next call share its key.
+        struct Segment {
+            uint64_t key;
+            size_t begin;
+        };
+
+        EntityManager &entityManager;
+        std::vector<Command> commands;
+        std::vector<Segment> segments;
+        Arena arena;
+
+        // Ids handed out by create(), kept in descending order so the smallest is taken first. A buffer owned by a
+        // ParallelCommandBuffer refills it under the shared mutex; a standalone one asks the EntityManager directly.
+        std::vector<Entity> reservedIds;
+        std::mutex *idMutex = nullptr;
+        size_t idBatch = 0;
+
+        void reserveIds(const size_t count) {
+            const auto ids = entityManager.getIndices(count);
+            reservedIds.insert(reservedIds.begin(), ids.rbegin(), ids.rend());
+        }
+
+        Entity takeId() {
+            if (reservedIds.empty()) {
+                if (!idMutex) {
+                    return entityManager.getIndex();
+                }
+                const std::lock_guard lock(*idMutex);
+                reserveIds(idBatch);
+            }
+            const auto entity = reservedIds.back();
+            reservedIds.pop_back();
+            return entity;
+        }
+
+        template<typename Payload>
+        static void discard(void *payload) { std::destroy_at(static_cast<Payload *>(payload)); }
+
+        template<typename... Components>
+        static size_t setBatch(ArchetypeStore &store, const std::span<const Entity> entities, const std::span<const Command *const> run) {
+            using Payload = std::tuple<Components...>;
+            const auto handled = store.setComponentsBatch<Components...>(entities, [run](const size_t i) -> Payload & {
+                return *static_cast<Payload *>(run[i]->payload);
+            });
+            if (handled == 0) {
+#ifndef NDEBUG
+                throw std::runtime_error("Failed to setup components");
+#endif
+                return 1;
+            }
+            return handled;
+        }
+
+        template<typename Component>
+        static size_t removeBatch(ArchetypeStore &store, const std::span<const Entity> entities, const std::span<const Command *const>) {
+            return std::max<size_t>(store.removeComponentBatch<Component>(entities), 1);
+        }
+
+        // Shared, chunk and sparse components don't live in plain columns, so their commands are applied one at a time.
+        template<typename... Components>
+        static constexpr Command::Batch setBatchFor() noexcept {
+            if constexpr (((!kIsShared<Components> && !kIsChunkComponent<Components> && !kIsSparse<Components>) && ...)) {
+                return &setBatch<Components...>;
+            } else {
+                return nullptr;
+            }
+        }
+
+        template<typename Component>
+        static constexpr Command::Batch removeBatchFor() noexcept {
+            if constexpr (!kIsSparse<Component>) {
+                return &removeBatch<Component>;
+            } else {
+                return nullptr;
+            }
+        }
+
+        template<typename... Components>
+        void recordSet(const CommandKind kind, const Entity entity, Components &&... components) {
+            using Payload = std::tuple<std::decay_t<Components>...>;
+            static_assert(sizeof(Payload) <= Arena::kMaxAllocation, "Command payload is too large");
+            auto *payload = new(arena.allocate(sizeof(Payload), alignof(Payload))) Payload(std::forward<Components>(components)...);
+            commands.push_back({
+                [](ArchetypeStore &store, const Entity target, void *data) {
+                    std::apply([&](auto &... values) {
+                        if (!store.setComponents(target, std::move(values)...)) {
+#ifndef NDEBUG
+                            throw std::runtime_error("Failed to setup components");
+#endif
+                        }
+                    }, *static_cast<Payload *>(data));
+                },
+                &discard<Payload>, setBatchFor<std::decay_t<Components>...>(), payload, entity, kind
+            });
+        }
+
+    public:
+        explicit EntityCommandBuffer(EntityManager &entityManager) : entityManager(entityManager) {
+        }
+
+        EntityCommandBuffer(const EntityCommandBuffer &) = delete;
+        EntityCommandBuffer &operator=(const EntityCommandBuffer &) = delete;
+
+        ~EntityCommandBuffer() {
+            clear();
+            entityManager.deleted.insert(entityManager.deleted.end(), reservedIds.begin(), reservedIds.end());
+        }
+
+        // The id is reserved right away so later commands can refer to the new entity.
+        template<typename... Components>
+        Entity create(Components &&... components) {
+            const auto entity = takeId();
+            recordSet(CommandKind::Create, entity, Entity{entity}, std::forward<Components>(components)...);
+            return entity;
+        }
+
+        template<typename... Components>
+        void setComponents(const Entity entity, Components &&... components) {
+            static_assert(sizeof...(Components) > 0, "setComponents needs at least one component");
+            recordSet(CommandKind::Set, entity, std::forward<Components>(components)...);
+        }
+
+        template<typename Component>
+        void setComponent(const Entity entity, Component &&component) {
+            recordSet(CommandKind::Set, entity, std::forward<Component>(component));
+        }
+
+        template<typename Component>
+        void removeComponent(const Entity entity) {
+            commands.push_back({
+                [](ArchetypeStore &store, const Entity target, void *) { store.removeComponent<std::decay_t<Component> >(target); },
+                nullptr, removeBatchFor<std::decay_t<Component> >(), nullptr, entity, CommandKind::Remove
+            });
+        }
+
+        void remove(const Entity entity) {
+            commands.push_back({nullptr, nullptr, nullptr, nullptr, entity, CommandKind::Destroy});
+        }
+
+        // Orders this buffer's commands against other buffers merged by a ParallelCommandBuffer, e.g. by the recording
+        // system and the chunk it was iterating. Commands sharing a key keep their recording order.
+        void setSortKey(const uint32_t system, const uint32_t chunk = 0) {
+            const Segment segment{static_cast<uint64_t>(system) << 32 | chunk, commands.size()};
+            if (!segments.empty() && segments.back().begin == segment.begin) {
+                segments.back() = segment;
+            } else {
+                segments.push_back(segment);
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept { return commands.size(); }
+        [[nodiscard]] bool empty() const noexcept { return commands.empty(); }
+        [[nodiscard]] size_t memoryBytes() const noexcept { return commands.capacity() * sizeof(Command) + arena.memoryBytes(); }
+
+        // Drops the recorded commands; ids reserved by create() go back to the EntityManager.
+        void clear() {
+            for (const auto &command: commands) {
+                if (command.kind == CommandKind::Create) {
+                    entityManager.deleted.push_back(command.entity);
+                }
+            }
+            reset();
+        }
+
+        // Applies the recorded commands and clears the buffer. Commands are grouped by the archetype their entity lives in
+        // when playback starts, so consecutive migrations share their source and target and move as one batch; within a
+        // group commands keep the order they were recorded in. An entity that is destroyed skips its other commands.
+        // Change notifications are delivered once per touched archetype when playback ends.
+        void playback() {
+            std::vector<const Command *> ordered;
+            ordered.reserve(commands.size());
+            for (const auto &command: commands) {
+                ordered.push_back(&command);
+            }
+            replay(entityManager, ordered);
+            reset();
+        }
+
+    private:
+        void reset() {
+            for (const auto &command: commands) {
+                if (command.discard) {
+                    command.discard(command.payload);
+                }
+            }
+            commands.clear();
+            segments.clear();
+            arena.reset();
+        }
+
+        static void replay(EntityManager &entityManager, const std::span<const Command *const> commands) {
+            auto &store = *entityManager.archetypeStore;
+            auto &notifier = *store.getChangeNotifier();
+            struct BatchScope {
+                ArchetypeStoreChangeNotifier &notifier;
+                ~BatchScope() { notifier.endBatch(); }
+            } scope{notifier};
+            notifier.beginBatch();
+
+            // Stable counting sort by source archetype; groups are numbered in order of first appearance.
+            std::vector<uint32_t> groups(commands.size());
+            std::vector<uint32_t> offsets;
+            std::unordered_map<const Archetype *, uint32_t> groupIndices;
+            std::vector<Entity> destroyed;
+            const Archetype *lastArchetype = nullptr;
+            uint32_t lastGroup = 0;
+            for (size_t i = 0; i < commands.size(); ++i) {
+                const auto *archetype = store.getArchetype(commands[i]->entity);
+                if (offsets.empty() || archetype != lastArchetype) {
+                    const auto [it, inserted] = groupIndices.try_emplace(archetype, static_cast<uint32_t>(offsets.size()));
+                    if (inserted) {
+                        offsets.push_back(0);
+                    }
+                    lastArchetype = archetype;
+                    lastGroup = it->second;
+                }
+                groups[i] = lastGroup;
+                ++offsets[lastGroup];
+                if (commands[i]->kind == CommandKind::Destroy) {
+                    destroyed.push_back(commands[i]->entity);
+                }
+            }
+            uint32_t total = 0;
+            for (auto &offset: offsets) {
+                total += std::exchange(offset, total);
+            }
+            std::vector<const Command *> order(commands.size());
+            for (size_t i = 0; i < commands.size(); ++i) {
+                order[offsets[groups[i]]++] = commands[i];
+            }
+
+            std::ranges::sort(destroyed);
+            const auto [last, _] = std::ranges::unique(destroyed);
+            destroyed.erase(last, destroyed.end());
+            const auto isDestroyed = [&destroyed](const Entity entity) {
+                return !destroyed.empty() && std::ranges::binary_search(destroyed, entity);
+            };
+            // Consecutive commands of the same type are handed to the store as one run, so entities sharing a source
+            // archetype migrate together.
+            std::vector<Entity> entities;
+            for (size_t i = 0; i < order.size();) {
+                const auto &command = *order[i];
+                if (isDestroyed(command.entity)) {
+                    // The id was reserved by create() and the entity never reached the store.
+                    if (command.kind == CommandKind::Create) {
+                        entityManager.deleted.push_back(command.entity);
+                    }
+                    ++i;
+                    continue;
+                }
+                size_t end = i + 1;
+                while (command.batch && end < order.size() && order[end]->batch == command.batch && !isDestroyed(order[end]->entity)) {
+                    ++end;
+                }
+                if (end - i == 1) {
+                    command.apply(store, command.entity, command.payload);
+                    ++i;
+                    continue;
+                }
+                entities.clear();
+                for (size_t j = i; j < end; ++j) {
+                    entities.push_back(order[j]->entity);
+                }
+                std::span<const Entity> remaining = entities;
+                std::span<const Command *const> run(order.data() + i, end - i);
+                while (!run.empty()) {
+                    const auto handled = command.batch(store, remaining, run);
+                    remaining = remaining.subspan(handled);
+                    run = run.subspan(handled);
+                }
+                i = end;
+            }
+            for (const auto entity: destroyed) {
+                if (store.getArchetype(entity)) {
+                    entityManager.remove(entity);
+                }
+            }
+        }
+    };
+}
@@ -7,12 +7,18 @@
 
 #pragma once
 
+#include <concepts>
 #include "Archetype/ArchetypeStore.hpp"
 #include "Archetype/ComponentView/ComponentViewSubscribed.hpp"
+#include "Archetype/ComponentView/SparseComponentView.hpp"
 #include "Entity.h"
 
 namespace ECS {
+    class EntityCommandBuffer;
+
     class EntityManager final {
+        friend class EntityCommandBuffer;
+
         std::vector<Entity> deleted;
         Entity lastCreated = 0;
 
@@ -27,6 +33,46 @@ namespace ECS {
             return ++lastCreated;
         }
 
+        std::vector<Entity> getIndices(const size_t count) {
+            std::vector<Entity> entities;
+            entities.reserve(count);
+            while (entities.size() < count && !deleted.empty()) {
+                entities.push_back(deleted.back());
+                deleted.pop_back();
+            }
+            while (entities.size() < count) {
+                entities.push_back(++lastCreated);
+            }
+            return entities;
+        }
+
+        void finishBatch(std::vector<Entity> &entities, const size_t placed) {
+            if (placed == entities.size()) {
+                return;
+            }
+            deleted.insert(deleted.end(), entities.begin() + static_cast<std::ptrdiff_t>(placed), entities.end());
+            entities.resize(placed);
+#ifndef NDEBUG
+            throw std::runtime_error("Failed to setup components");
+#endif
+        }
+
+        template<typename Component>
+        static Component &construct(Component *column, const size_t row) {
+            if constexpr (kIsTag<Component>) {
+                return tagInstance<Component>;
+            } else {
+                return *new(column + row) Component{};
+            }
+        }
+
+        template<typename Component>
+        static void copyColumn(Component *column, const Component *values, const size_t count) {
+            if constexpr (!kIsTag<Component>) {
+                std::memcpy(column, values, count * sizeof(Component));
+            }
+        }
+
     public:
         EntityManager() : archetypeStore(std::make_unique<ArchetypeStore>()) {
         }
@@ -48,6 +94,48 @@ namespace ECS {
             return value;
         }
 
+        // Creates `count` entities with `Components`, filling them chunk by chunk. Each component is default-constructed
+        // in place and then passed to `init(index, components&...)`, where index is the position within the batch.
+        template<typename... Components, typename Init>
+            requires std::invocable<Init &, size_t, Components &...>
+        std::vector<Entity> createBatch(const size_t count, Init &&init) {
+            auto entities = getIndices(count);
+            const auto placed = archetypeStore->createBatch<Components...>(entities, [&](const size_t first, const size_t n, Components *... columns) {
+                for (size_t i = 0; i < n; ++i) {
+                    init(first + i, construct<Components>(columns, i)...);
+                }
+            });
+            finishBatch(entities, placed);
+            return entities;
+        }
+
+        // Creates one entity per element, copying whole runs of each span into the chunk columns.
+        template<typename... Components>
+        std::vector<Entity> createBatch(const std::span<const Components>... values) {
+            static_assert(sizeof...(Components) > 0, "createBatch needs at least one component");
+            const std::array<size_t, sizeof...(Components)> sizes{values.size()...};
+            const auto count = *std::ranges::min_element(sizes);
+#ifndef NDEBUG
+            if (*std::ranges::max_element(sizes) != count) {
+                throw std::runtime_error("createBatch spans differ in size");
+            }
+#endif
+            auto entities = getIndices(count);
+            const auto placed = archetypeStore->createBatch<Components...>(entities, [&](const size_t first, const size_t n, Components *... columns) {
+                (copyColumn(columns, values.data() + first, n), ...);
+            });
+            finishBatch(entities, placed);
+            return entities;
+        }
+
+        // Creates `count` entities holding the same components and values as `prefab`.
+        std::vector<Entity> instantiate(const Entity prefab, const size_t count) {
+            auto entities = getIndices(count);
+            const auto placed = archetypeStore->instantiate(prefab, entities);
+            finishBatch(entities, placed);
+            return entities;
+        }
+
         template<typename Component>
         inline Component *getComponent(const Entity entity) const { return archetypeStore->getComponent<Component>(entity); }
 
@@ -83,6 +171,18 @@ namespace ECS {
 
         [[nodiscard]] const Signature& getSignature(const Entity entity) const  { return archetypeStore->getSignature(entity); }
 
+        // Disabled components keep their value and column; views skip the entity until it is enabled again.
+        template<typename Component>
+        bool setEnabled(const Entity entity, const bool enabled) const { return archetypeStore->setEnabled<Component>(entity, enabled); }
+
+        template<typename Component>
+        [[nodiscard]] bool isEnabled(const Entity entity) const { return archetypeStore->isEnabled<Component>(entity); }
+
+        // Call before creating entities with the component: only archetypes created afterwards move its column to the
+        // companion block.
+        template<typename Component>
+        void setCold(const bool cold = true) const { archetypeStore->setCold<Component>(cold); }
+
         template<typename Component>
         void removeComponent(const Entity entity) const {
             if (!hasComponent<Component>(entity)) {
@@ -96,19 +196,74 @@ namespace ECS {
             deleted.push_back(entity);
         }
 
+        [[nodiscard]] Chunks::ChunkPoolStats getMemoryStats() const { return archetypeStore->getChunkPool()->getStats(); }
+
+        void setMemoryBudget(const size_t bytes) const { archetypeStore->getChunkPool()->setMemoryBudget(bytes); }
+
+        size_t trimMemory() const { return archetypeStore->getChunkPool()->trim(); }
+
+        [[nodiscard]] double getFillFactor() const { return archetypeStore->getFillFactor(); }
+
+        CompactionStats compact(const size_t maxMoves = std::numeric_limits<size_t>::max()) const { return archetypeStore->compact(maxMoves); }
+
+        void setCompactionPolicy(const double minFillFactor, const size_t movesPerStep) const {
+            archetypeStore->setCompactionPolicy(minFillFactor, movesPerStep);
+        }
+
         template<typename... Components>
         struct Query{};
         
+        // Queries touching a sparse component get a SparseComponentView, which joins it with archetype columns.
         template<typename... Included, typename... Excluded>
         [[nodiscard]]
-        ComponentViewSubscribed<Included...> createComponentViewWithQuery(Query<Included...>, Query<Excluded...>) const {
-            Signature excluding = SignatureID<Excluded...>::signature();
-            return ComponentViewSubscribed<Included...>(archetypeStore, excluding);
+        auto createComponentViewWithQuery(Query<Included...> included, Query<Excluded...> excluded) const {
+            return createComponentViewWithQuery(included, excluded, Query{});
         }
         
+        // Entities must also have `Required...`; use it for tags, which have no column to iterate.
+        template<typename... Included, typename... Excluded, typename... Required>
+        [[nodiscard]]
+        auto createComponentViewWithQuery(Query<Included...>, Query<Excluded...>, Query<Required...>) const {
+            if constexpr ((kIsSparse<Included> || ...) || (kIsSparse<Excluded> || ...) || (kIsSparse<Required> || ...)) {
+                return SparseComponentView<Included...>(archetypeStore, SignatureID<Excluded...>::signature(), SignatureID<Required...>::signature());
+            } else {
+                return ComponentViewSubscribed<Included...>(archetypeStore, SignatureID<Excluded...>::signature(), SignatureID<Required...>::signature());
+            }
+        }
+
         template<typename... Components>
-        [[nodiscard]] ComponentViewSubscribed<Components...> createComponentView() const {
+        [[nodiscard]] auto createComponentView() const {
             return createComponentViewWithQuery(Query<Components...>{}, Query{});
         }
+
+        // Adds `component` to every entity matching the query by moving whole archetypes. Returns the number of entities updated.
+        template<typename... Included, typename... Excluded, typename Component>
+        size_t addComponentToAll(Query<Included...>, Query<Excluded...>, Component &&component) {
+            return archetypeStore->addComponentToAll<std::decay_t<Component> >(SignatureID<Included...>::signature(),
+                                                                               SignatureID<Excluded...>::signature(), component);
+        }
+
+        // Removes `Component` from every entity matching the query by moving whole archetypes. Returns the number of entities updated.
+        template<typename Component, typename... Included, typename... Excluded>
+        size_t removeComponentFromAll(Query<Included...>, Query<Excluded...> = {}) {
+            return archetypeStore->removeComponentFromAll<Component>(SignatureID<Included...>::signature(), SignatureID<Excluded...>::signature());
+        }
+
+        // Destroys every entity matching the query, releasing whole archetypes' chunks at once. Returns the number destroyed.
+        template<typename... Included, typename... Excluded>
+        size_t destroyAll(Query<Included...>, Query<Excluded...> = {}) {
+            const auto before = deleted.size();
+            archetypeStore->destroyAll(SignatureID<Included...>::signature(), SignatureID<Excluded...>::signature(), deleted);
+            return deleted.size() - before;
+        }
+
+        // Destroys the entities matching the query for which `predicate(Included&...)` returns true.
+        template<typename... Included, typename... Excluded, typename Predicate>
+            requires std::predicate<Predicate &, Included &...>
+        size_t destroy(Query<Included...>, Query<Excluded...>, Predicate &&predicate) {
+            const auto before = deleted.size();
+            archetypeStore->destroyIf<Included...>(SignatureID<Excluded...>::signature(), std::forward<Predicate>(predicate), deleted);
+            return deleted.size() - before;
+        }
     };
 }
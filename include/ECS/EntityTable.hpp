@@ -0,0 +1,68 @@
+//
+//  EntityTable.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include "Entity.h"
+
+namespace ECS {
+    // Entity-indexed table split into fixed-size pages that are allocated on first write.
+    // Reading an entity whose page was never written yields a value-initialized Value.
+    template<typename Value, size_t PageSize = 4096>
+    class EntityTable final {
+        static_assert((PageSize & (PageSize - 1)) == 0, "PageSize must be a power of two");
+
+        using Page = std::array<Value, PageSize>;
+
+        static inline const Value kEmpty{};
+
+        std::vector<std::unique_ptr<Page> > pages;
+
+    public:
+        explicit EntityTable(const size_t reserveEntities = 0) {
+            pages.reserve((reserveEntities + PageSize - 1) / PageSize);
+        }
+
+        [[nodiscard]] const Value &get(const Entity entity) const noexcept {
+            const size_t page = entity / PageSize;
+            if (page >= pages.size() || !pages[page]) {
+                [[unlikely]] return kEmpty;
+            }
+            return (*pages[page])[entity & (PageSize - 1)];
+        }
+
+        [[nodiscard]] bool contains(const Entity entity) const noexcept {
+            const size_t page = entity / PageSize;
+            return page < pages.size() && pages[page];
+        }
+
+        Value &operator[](const Entity entity) {
+            const size_t page = entity / PageSize;
+            if (page >= pages.size()) {
+                [[unlikely]] pages.resize(page + 1);
+            }
+            auto &slot = pages[page];
+            if (!slot) {
+                [[unlikely]] slot = std::make_unique<Page>();
+            }
+            return (*slot)[entity & (PageSize - 1)];
+        }
+
+        [[nodiscard]] size_t pageCount() const noexcept {
+            size_t count = 0;
+            for (const auto &page: pages) {
+                count += page != nullptr;
+            }
+            return count;
+        }
+
+        [[nodiscard]] size_t memoryBytes() const noexcept {
+            return pages.capacity() * sizeof(std::unique_ptr<Page>) + pageCount() * sizeof(Page);
+        }
+    };
+}
@@ -0,0 +1,114 @@
+//
+//  ParallelCommandBuffer.hpp
+//  AECS
+//
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "EntityCommandBuffer.hpp"
+
+namespace ECS {
+    // One EntityCommandBuffer per recording thread, merged at a sync point. Writers never touch the EntityManager while
+    // recording: create() draws ids from a range reserved up front, and only a writer that runs out takes a shared lock.
+    //
+    // Playback is reproducible when every writer is picked by a deterministic slot (not by whichever OS thread runs the
+    // job) and commands are tagged with setSortKey(system, chunk). Segments are merged by key, then by writer slot, so
+    // the order never depends on thread timing. Id ranges are topped up in slot order after each playback.
+    class ParallelCommandBuffer final {
+        EntityManager &entityManager;
+        std::vector<std::unique_ptr<EntityCommandBuffer> > writers;
+        const size_t idsPerWriter;
+        std::mutex idMutex;
+
+        void topUpIds() {
+            for (const auto &writer: writers) {
+                if (writer->reservedIds.size() < idsPerWriter) {
+                    writer->reserveIds(idsPerWriter - writer->reservedIds.size());
+                }
+            }
+        }
+
+    public:
+        ParallelCommandBuffer(EntityManager &entityManager, const size_t writerCount, const size_t idsPerWriter = 1024)
+            : entityManager(entityManager), idsPerWriter(std::max<size_t>(idsPerWriter, 1)) {
+            writers.reserve(writerCount);
+            for (size_t i = 0; i < writerCount; ++i) {
+                auto writer = std::make_unique<EntityCommandBuffer>(entityManager);
+                writer->idMutex = &idMutex;
+                writer->idBatch = this->idsPerWriter;
+                writers.push_back(std::move(writer));
+            }
+            topUpIds();
+        }
+
+        ParallelCommandBuffer(const ParallelCommandBuffer &) = delete;
+        ParallelCommandBuffer &operator=(const ParallelCommandBuffer &) = delete;
+
+        // Each slot must be used by one thread at a time.
+        [[nodiscard]] EntityCommandBuffer &writer(const size_t slot) noexcept { return *writers[slot]; }
+        [[nodiscard]] size_t writerCount() const noexcept { return writers.size(); }
+
+        [[nodiscard]] size_t size() const noexcept {
+            size_t count = 0;
+            for (const auto &writer: writers) {
+                count += writer->size();
+            }
+            return count;
+        }
+
+        void clear() {
+            for (const auto &writer: writers) {
+                writer->clear();
+            }
+        }
+
+        // Must be called once all writers are done recording.
+        void playback() {
+            struct Range {
+                uint64_t key;
+                size_t writer;
+                size_t begin;
+                size_t end;
+            };
+            std::vector<Range> ranges;
+            size_t total = 0;
+            for (size_t w = 0; w < writers.size(); ++w) {
+                const auto &writer = *writers[w];
+                const auto &segments = writer.segments;
+                const auto count = writer.commands.size();
+                total += count;
+                const size_t first = segments.empty() ? count : segments.front().begin;
+                if (first > 0) {
+                    ranges.push_back({0, w, 0, first});
+                }
+                for (size_t i = 0; i < segments.size(); ++i) {
+                    const auto end = i + 1 < segments.size() ? segments[i + 1].begin : count;
+                    if (end > segments[i].begin) {
+                        ranges.push_back({segments[i].key, w, segments[i].begin, end});
+                    }
+                }
+            }
+            std::ranges::stable_sort(ranges, [](const Range &lhs, const Range &rhs) {
+                return lhs.key != rhs.key ? lhs.key < rhs.key : lhs.writer < rhs.writer;
+            });
+
+            std::vector<const EntityCommandBuffer::Command *> ordered;
+            ordered.reserve(total);
+            for (const auto &range: ranges) {
+                const auto &commands = writers[range.writer]->commands;
+                for (size_t i = range.begin; i < range.end; ++i) {
+                    ordered.push_back(&commands[i]);
+                }
+            }
+            EntityCommandBuffer::replay(entityManager, ordered);
+            for (const auto &writer: writers) {
+                writer->reset();
+            }
+            topUpIds();
+        }
+    };
+}
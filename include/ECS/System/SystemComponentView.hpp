@@ -8,19 +8,23 @@
 #pragma once
 
 #include "System.hpp"
+#include <utility>
 #include <ECS/Archetype/ComponentView/ComponentViewSubscribed.hpp>
 
 namespace ECS {
     template<typename... Components>
     class SystemComponentView : public Updatable {
+    public:
+        // ComponentViewSubscribed, or SparseComponentView when one of the components is sparse.
+        using View = decltype(std::declval<const EntityManager &>().template createComponentView<Components...>());
 
     protected:
-        ComponentViewSubscribed<Components...> componentView;
+        View componentView;
 
     public:
         using EntityInfo = std::tuple<Components &...>;
 
-        explicit SystemComponentView(ComponentViewSubscribed<Components...> &&componentView) : componentView(std::move(componentView)) {
+        explicit SystemComponentView(View &&componentView) : componentView(std::move(componentView)) {
         }
 
         explicit SystemComponentView(const std::shared_ptr<EntityManager> &manager) : componentView(manager->createComponentView<Components...>()) {